@@ -4,6 +4,36 @@
 #include "MemLeak.h"
 
 
+////////////////////////////////
+//
+// class AlleleIndex
+
+void AlleleIndex::set(const Allele &a, int index)
+{
+	int i, v, lo, hi;
+	if (a.isMissing()) return;
+	v = a.asInt();
+	if (m_sparse.empty()) {
+		lo = m_dense.empty() ? v : min(m_min, v);
+		hi = m_dense.empty() ? v : max(m_min+(int)m_dense.size()-1, v);
+		if (hi - lo < max_dense_range) {
+			if (lo < m_min || m_dense.empty()) {
+				m_dense.insert(m_dense.begin(), m_dense.empty() ? 0 : m_min-lo, -1);
+				m_min = lo;
+			}
+			m_dense.resize(hi-lo+1, -1);
+			m_dense[v-m_min] = index;
+			return;
+		}
+		for (i=0; i<m_dense.size(); ++i) {						// range too wide, switch to the map
+			if (m_dense[i] >= 0) m_sparse[m_min+i] = m_dense[i];
+		}
+		m_dense.clear();
+	}
+	m_sparse[v] = index;
+}
+
+
 ////////////////////////////////
 //
 // class AlleleSequence
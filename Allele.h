@@ -4,6 +4,7 @@
 
 
 #include <vector>
+#include <map>
 
 #include "Utils.h"
 
@@ -61,6 +62,37 @@ inline bool operator >=(const Allele &lhs, const Allele &rhs)
 }
 
 
+// Maps the symbols of one locus to their allele indexes in O(1) with a
+// table over the range of symbol values.  Loci with widely spread values
+// (e.g. microsatellite lengths) fall back to a map.
+
+class AlleleIndex {
+	int m_min;
+	vector<int> m_dense;
+	map<int, int> m_sparse;
+
+public:
+	static const int max_dense_range = 4096;
+
+	AlleleIndex() : m_min(0) { }
+
+	int find(const Allele &a) const;
+	void set(const Allele &a, int index);
+	void clear() { m_dense.clear(); m_sparse.clear(); m_min = 0; }
+};
+
+inline int AlleleIndex::find(const Allele &a) const
+{
+	if (a.isMissing()) return -1;
+	if (!m_sparse.empty()) {
+		map<int, int>::const_iterator i = m_sparse.find(a.asInt());
+		return i != m_sparse.end() ? i->second : -1;
+	}
+	unsigned int offset = a.asInt() - m_min;
+	return offset < m_dense.size() ? m_dense[offset] : -1;
+}
+
+
 class AlleleSequence {
 protected:
 	vector<Allele> m_alleles;
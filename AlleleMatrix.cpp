@@ -0,0 +1,58 @@
+#include "AlleleMatrix.h"
+
+#include "MemLeak.h"
+
+
+////////////////////////////////
+//
+// class AlleleMatrix
+
+AlleleMatrix::AlleleMatrix(int rows, int cols, int code_num)
+: m_rows(0),
+  m_cols(0),
+  m_bits(2),
+  m_row_words(0)
+{
+	resize(rows, cols, code_num);
+}
+
+int AlleleMatrix::getBits(int code_num)
+{
+	int n = code_num + 1;						// one more code for missing
+	if (n <= 4) return 2;
+	if (n <= 16) return 4;
+	if (n <= 256) return 8;
+	Logger::error("Too many alleles (%d) at one locus!", code_num);
+	exit(1);
+	return 0;
+}
+
+void AlleleMatrix::resize(int rows, int cols, int code_num)
+{
+	int i, j, c, n, m;
+	int bits = getBits(code_num);
+	cols = cols > 0 ? cols : 0;
+	if (cols == m_cols && bits == m_bits) {
+		resize(rows);
+	}
+	else {
+		AlleleMatrix am;
+		am.m_cols = cols;
+		am.m_bits = bits;
+		am.m_row_words = (cols * bits + 31) / 32;
+		am.resize(rows);
+		n = am.m_rows < m_rows ? am.m_rows : m_rows;
+		m = am.m_cols < m_cols ? am.m_cols : m_cols;
+		for (i=0; i<n; ++i) {
+			for (j=0; j<m; ++j) {
+				c = (*this)(i, j);
+				am.set(i, j, c == missing() ? -1 : c);
+			}
+		}
+		m_words.swap(am.m_words);
+		m_rows = am.m_rows;
+		m_cols = am.m_cols;
+		m_bits = am.m_bits;
+		m_row_words = am.m_row_words;
+	}
+}
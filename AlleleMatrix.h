@@ -0,0 +1,62 @@
+#ifndef __ALLELEMATRIX_H
+#define __ALLELEMATRIX_H
+
+
+#include <vector>
+
+#include "Utils.h"
+
+
+// Allele indices of a set of sequences over the same loci, one row per
+// sequence, packed into 2, 4 or 8 bits each.  The all-ones code of the
+// width stands for a missing allele.
+
+class AlleleMatrix {
+	vector<unsigned int> m_words;
+	int m_rows, m_cols;
+	int m_bits;
+	int m_row_words;
+
+public:
+	AlleleMatrix() : m_rows(0), m_cols(0), m_bits(2), m_row_words(0) { }
+	explicit AlleleMatrix(int rows, int cols, int code_num = 2);
+
+	int rows() const { return m_rows; }
+	int cols() const { return m_cols; }
+	int bits() const { return m_bits; }
+	int missing() const { return (1 << m_bits) - 1; }
+	size_t memory() const { return m_words.size() * sizeof(unsigned int); }
+
+	int operator ()(int row, int col) const;
+	void set(int row, int col, int code);
+
+	void resize(int rows);
+	void resize(int rows, int cols, int code_num);
+	void clear() { resize(0); }
+
+	static int getBits(int code_num);
+};
+
+inline int AlleleMatrix::operator ()(int row, int col) const
+{
+	int bit = col * m_bits;
+	return (m_words[row*m_row_words+(bit>>5)] >> (bit&31)) & missing();
+}
+
+inline void AlleleMatrix::set(int row, int col, int code)
+{
+	int bit = col * m_bits;
+	unsigned int &word = m_words[row*m_row_words+(bit>>5)];
+	if (code < 0 || code > missing()) code = missing();
+	word &= ~((unsigned int) missing() << (bit&31));
+	word |= (unsigned int) code << (bit&31);
+}
+
+inline void AlleleMatrix::resize(int rows)
+{
+	m_rows = rows > 0 ? rows : 0;
+	m_words.resize(m_rows*m_row_words, ~0u);
+}
+
+
+#endif // __ALLELEMATRIX_H
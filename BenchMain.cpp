@@ -0,0 +1,21 @@
+
+#include "Benchmark.h"
+
+#include "MemLeak.h"
+
+
+int main(int argc, char *argv[])
+{
+	EnableMemLeakCheck();
+
+	try {
+		Benchmark bench(argc, argv);
+		bench.run();
+	}
+	catch (exception &e)
+	{
+		Logger::error("%s", e.what());
+		return 1;
+	}
+	return 0;
+}
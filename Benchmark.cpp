@@ -0,0 +1,368 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "Benchmark.h"
+#include "HaploComp.h"
+#include "Options.h"
+
+#include "MemLeak.h"
+
+
+////////////////////////////////
+//
+// class PanelGenerator
+
+PanelGenerator::PanelGenerator()
+: sample_num(100),
+  marker_num(200),
+  allele_num(2),
+  founder_num(20),
+  segment_len(50),
+  heterozygosity(0.3),
+  missing_rate(0.01),
+  seed(1)
+{
+}
+
+void PanelGenerator::generate(GenoData &real, GenoData &input)
+{
+	int i, j, k, f;
+	Haplotype h[2];
+	m_random.seed(seed);
+	generateFounders();
+	real = GenoData(sample_num, marker_num);
+	for (j=0; j<marker_num; ++j) {
+		real.setAlleleType(j, allele_num == 2 ? 'S' : 'M');
+		real.setAlleleName(j, "M" + int2str(j+1));
+	}
+	for (i=0; i<sample_num; ++i) {
+		for (k=0; k<2; ++k) {
+			h[k].setLength(marker_num);
+			f = random(founder_num);
+			for (j=0; j<marker_num; ++j) {
+				if (j > 0 && random() * segment_len < 1.0) {
+					f = random(founder_num);
+				}
+				h[k][j] = alleleSymbol(m_founders[f][j]);
+			}
+		}
+		real[i].setID(int2str(i+1));
+		real[i].setHaplotypes(h[0], h[1]);
+	}
+	real.checkAlleleSymbol();
+	input = real;
+	for (i=0; i<sample_num; ++i) {
+		Genotype &g = input[i];
+		for (j=0; j<marker_num; ++j) {
+			if (random() < missing_rate) {
+				g(0)[j] = g(1)[j] = Allele();
+				real[i](0)[j] = real[i](1)[j] = Allele();
+			}
+			else if (random() < 0.5) {
+				swap(g(0)[j], g(1)[j]);
+			}
+		}
+		g.checkGenotype();
+		real[i].checkGenotype();
+	}
+	input.checkAlleleSymbol();
+}
+
+// With m = allele_num-1 minor alleles of frequency (1-q)/m, the expected
+// heterozygosity 1 - q^2 - (1-q)^2/m is solved for the major frequency q.
+void PanelGenerator::generateFounders()
+{
+	int i, j, m;
+	m = allele_num - 1;
+	m_major_freq = (1.0 + sqrt(max(0.0, m * ((m + 1) * (1.0 - heterozygosity) - 1.0)))) / (m + 1);
+	m_founders.resize(founder_num);
+	for (i=0; i<founder_num; ++i) {
+		m_founders[i].resize(marker_num);
+		for (j=0; j<marker_num; ++j) {
+			m_founders[i][j] = random() < m_major_freq ? 0 : 1 + random(m);
+		}
+	}
+}
+
+Allele PanelGenerator::alleleSymbol(int index) const
+{
+	return allele_num == 2 ? Allele('A' + index) : Allele(index + 1);
+}
+
+
+////////////////////////////////
+//
+// class StopWatch
+//
+// Wall clock time and processor time as clock() reports it (the time of
+// all threads on most systems, wall clock time on Windows).
+
+class StopWatch {
+	boost::posix_time::ptime m_start;
+	clock_t m_clock;
+
+public:
+	StopWatch() : m_start(boost::posix_time::microsec_clock::universal_time()), m_clock(clock()) { }
+
+	double seconds() const;
+	double cpu_seconds() const { return (double) (clock() - m_clock) / CLOCKS_PER_SEC; }
+};
+
+double StopWatch::seconds() const
+{
+	return (boost::posix_time::microsec_clock::universal_time() - m_start).total_microseconds() / 1e6;
+}
+
+
+////////////////////////////////
+//
+// class Benchmark
+
+const char *Benchmark::m_stage_names[stage_num] = { "search_patterns", "resolve", "estimate_frequency", "compare" };
+
+Benchmark::Benchmark(int argc, char *argv[])
+{
+	po::options_description generics("Generic options");
+	generics.add_options()
+		("help,h", "Show help message")
+		("debug,d", po::value<int>()->default_value(2), "Set debug level")
+		("format", po::value<string>(&m_format)->default_value("csv"), "Output format, csv or json")
+		("output,o", po::value<string>(&m_output)->default_value("-"), "Output file (- for the standard output)")
+		("runs", po::value<int>(&m_run_num)->default_value(3), "Number of timed runs, each with a new model")
+		("no-header", "Do not write the CSV header line")
+		;
+
+	po::options_description panel("Synthetic panel");
+	panel.add_options()
+		("samples", po::value<int>(&m_generator.sample_num)->default_value(100), "Number of genotypes")
+		("markers", po::value<int>(&m_generator.marker_num)->default_value(200), "Number of markers")
+		("alleles", po::value<int>(&m_generator.allele_num)->default_value(2), "Number of alleles per marker")
+		("founders", po::value<int>(&m_generator.founder_num)->default_value(20), "Number of founder haplotypes the panel is a mosaic of")
+		("segment-length", po::value<double>(&m_generator.segment_len)->default_value(50), "Mean number of markers copied from one founder")
+		("heterozygosity", po::value<double>(&m_generator.heterozygosity)->default_value(0.3), "Expected heterozygosity of each marker")
+		("missing-rate", po::value<double>(&m_generator.missing_rate)->default_value(0.01), "Fraction of genotype sites with both alleles missing")
+		("seed", po::value<unsigned int>(&m_generator.seed)->default_value(1), "Random seed of the panel and the model")
+		;
+
+	po::options_description parameters("Model parameters");
+	parameters.add_options()
+		("threads", po::value<int>(&m_builder.thread_num)->default_value(1), "Number of worker threads")
+		("model,m", po::value<string>()->default_value("MV"), "Set the inference model")
+		("min-freq-abs,a", po::value<double>(&m_builder.min_freq_abs)->default_value(1.5), "Minimum absolute frequency of patterns")
+		("num-patterns,n", po::value<int>(&m_builder.num_patterns), "Maximum number of patterns")
+		("max-pattern-len", po::value<int>(&m_builder.max_pattern_len)->default_value(30), "Maximum length of patterns")
+		("mc-order", po::value<int>(&m_builder.mc_order)->default_value(1), "Markov chain order")
+		("beam-width", po::value<int>(&m_builder.beam_width)->default_value(0), "Keep at most this many haplotype pairs per locus (0 keeps all)")
+		("beam-ratio", po::value<double>(&m_builder.beam_ratio)->default_value(0), "Drop haplotype pairs less likely than this ratio of the best one")
+		("sample-size", po::value<int>(&m_builder.sample_size)->default_value(10), "Sample some most probable configurations")
+		("posterior-samples", po::value<int>(&m_builder.posterior_samples)->default_value(0), "Draw this many configurations from the posterior instead of sampling the most probable ones (0 disables)")
+		;
+
+	m_options.add(generics).add(panel).add(parameters);
+
+	po::store(po::command_line_parser(argc, argv).options(m_options).run(), m_args);
+	po::notify(m_args);
+
+	conflicting_options(m_args, "min-freq-abs", "num-patterns");
+
+	parseOptions();
+}
+
+void Benchmark::usage()
+{
+	cout << "Usage: Benchmark [option ...]" << "\n";
+	cout << m_options << "\n";
+}
+
+void Benchmark::parseOptions()
+{
+	Logger::setLogLevel(m_args["debug"].as<int>());
+	if (m_args.count("help")) {
+		usage();
+		exit(0);
+	}
+	m_header = !m_args.count("no-header");
+
+	if (m_format != "csv" && m_format != "json") {
+		Logger::error("Unknown output format %s!", m_format.c_str());
+		exit(1);
+	}
+	if (m_run_num < 1) {
+		Logger::error("The value of option --runs must be positive!");
+		exit(1);
+	}
+	if (m_generator.sample_num < 1 || m_generator.marker_num < 2 || m_generator.founder_num < 1) {
+		Logger::error("The panel needs at least one sample, two markers and one founder!");
+		exit(1);
+	}
+	if (m_generator.allele_num < 2) {
+		Logger::error("The value of option --alleles must be at least 2!");
+		exit(1);
+	}
+	if (m_generator.segment_len < 1) {
+		Logger::error("The value of option --segment-length must be at least 1!");
+		exit(1);
+	}
+	if (m_generator.heterozygosity < 0 || m_generator.heterozygosity > m_generator.max_heterozygosity()) {
+		Logger::error("The heterozygosity of markers with %d alleles must be between 0 and %f!",
+			m_generator.allele_num, m_generator.max_heterozygosity());
+		exit(1);
+	}
+	if (m_generator.missing_rate < 0 || m_generator.missing_rate >= 1) {
+		Logger::error("The value of option --missing-rate must be at least 0 and less than 1!");
+		exit(1);
+	}
+
+	m_builder.setModel(m_args["model"].as<string>());
+	m_builder.max_iteration = 1;
+}
+
+void Benchmark::run()
+{
+	int i, j, n;
+	FILE *fp;
+
+	Logger::verbose("Generating panel of %d markers and %d genotypes ...", m_generator.marker_num, m_generator.sample_num);
+	m_generator.generate(m_real, m_input);
+	n = 0;
+	m_observed_heterozygosity = 0;
+	for (i=0; i<m_input.genotype_num(); ++i) {
+		for (j=0; j<m_input.genotype_len(); ++j) {
+			if (!m_input[i].hasMissing(j)) {
+				if (m_input[i].isHeterozygous(j)) m_observed_heterozygosity++;
+				n++;
+			}
+		}
+	}
+	if (n > 0) m_observed_heterozygosity /= n;
+
+	srand(m_generator.seed);					// the lattices seed their random draws from rand()
+	m_seconds.assign(stage_num, vector<double>(m_run_num, 0));
+	m_cpu_seconds.assign(stage_num, vector<double>(m_run_num, 0));
+	for (i=0; i<m_run_num; ++i) {
+		Logger::verbose("Run %d of %d ...", i+1, m_run_num);
+		runOnce(i);
+	}
+
+	if (m_output == "-") {
+		fp = stdout;
+	}
+	else {
+		fp = fopen(m_output.c_str(), "w");
+		if (fp == NULL) {
+			Logger::error("Can not open file %s!", m_output.c_str());
+			exit(1);
+		}
+	}
+	if (m_format == "json") {
+		writeJSON(fp);
+	}
+	else {
+		writeCSV(fp);
+	}
+	if (fp != stdout) {
+		fclose(fp);
+	}
+}
+
+void Benchmark::runOnce(int run)
+{
+	BenchModel model;
+	GenoData unphased = m_input;
+	m_resolutions = m_input;
+	model.copyParameters(m_builder);
+	model.thread_num = m_builder.thread_num;
+
+	StopWatch search_watch;
+	model.searchPatterns(unphased);
+	m_seconds[search][run] = search_watch.seconds();
+	m_cpu_seconds[search][run] = search_watch.cpu_seconds();
+
+	StopWatch resolve_watch;
+	m_log_likelihood = model.resolveAll(unphased, m_resolutions);
+	m_seconds[resolve][run] = resolve_watch.seconds();
+	m_cpu_seconds[resolve][run] = resolve_watch.cpu_seconds();
+
+	StopWatch estimate_watch;
+	model.estimateFrequency();
+	m_seconds[estimate][run] = estimate_watch.seconds();
+	m_cpu_seconds[estimate][run] = estimate_watch.cpu_seconds();
+
+	StopWatch compare_watch;
+	HaploComp comp(&m_real, &m_resolutions);
+	m_seconds[compare][run] = compare_watch.seconds();
+	m_cpu_seconds[compare][run] = compare_watch.cpu_seconds();
+
+	m_pattern_num = model.pattern_num();
+	m_switch_error = comp.switch_error();
+	m_incorrect_haplotype_percentage = comp.incorrect_haplotype_percentage();
+	m_incorrect_genotype_percentage = comp.incorrect_genotype_percentage();
+}
+
+// one line per stage, so the output of several runs can be concatenated
+void Benchmark::writeCSV(FILE *fp) const
+{
+	int i;
+	if (m_header) {
+		fprintf(fp, "stage,samples,markers,alleles,founders,segment_length,heterozygosity,missing_rate,seed,"
+			"model,threads,runs,best_seconds,mean_seconds,mean_cpu_seconds\n");
+	}
+	for (i=0; i<stage_num; ++i) {
+		fprintf(fp, "%s,%d,%d,%d,%d,%g,%g,%g,%u,%s,%d,%d,%.6f,%.6f,%.6f\n", m_stage_names[i],
+			m_generator.sample_num, m_generator.marker_num, m_generator.allele_num, m_generator.founder_num,
+			m_generator.segment_len, m_generator.heterozygosity, m_generator.missing_rate, m_generator.seed,
+			m_args["model"].as<string>().c_str(), m_builder.thread_num, m_run_num,
+			bestSeconds(i), meanSeconds(i), meanCPUSeconds(i));
+	}
+}
+
+void Benchmark::writeJSON(FILE *fp) const
+{
+	int i, j;
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"panel\": {\"samples\": %d, \"markers\": %d, \"alleles\": %d, \"founders\": %d, "
+		"\"segment_length\": %g, \"heterozygosity\": %g, \"observed_heterozygosity\": %g, "
+		"\"missing_rate\": %g, \"seed\": %u},\n",
+		m_generator.sample_num, m_generator.marker_num, m_generator.allele_num, m_generator.founder_num,
+		m_generator.segment_len, m_generator.heterozygosity, m_observed_heterozygosity,
+		m_generator.missing_rate, m_generator.seed);
+	fprintf(fp, "  \"model\": {\"model\": \"%s\", \"threads\": %d, \"patterns\": %d, \"log_likelihood\": %f},\n",
+		m_args["model"].as<string>().c_str(), m_builder.thread_num, m_pattern_num, m_log_likelihood);
+	fprintf(fp, "  \"accuracy\": {\"switch_error\": %f, \"incorrect_haplotype_percentage\": %f, "
+		"\"incorrect_genotype_percentage\": %f},\n",
+		m_switch_error, m_incorrect_haplotype_percentage, m_incorrect_genotype_percentage);
+	fprintf(fp, "  \"runs\": %d,\n", m_run_num);
+	fprintf(fp, "  \"stages\": [\n");
+	for (i=0; i<stage_num; ++i) {
+		fprintf(fp, "    {\"stage\": \"%s\", \"best_seconds\": %.6f, \"mean_seconds\": %.6f, \"mean_cpu_seconds\": %.6f, \"seconds\": [",
+			m_stage_names[i], bestSeconds(i), meanSeconds(i), meanCPUSeconds(i));
+		for (j=0; j<m_run_num; ++j) {
+			fprintf(fp, j > 0 ? ", %.6f" : "%.6f", m_seconds[i][j]);
+		}
+		fprintf(fp, i < stage_num-1 ? "]},\n" : "]}\n");
+	}
+	fprintf(fp, "  ]\n");
+	fprintf(fp, "}\n");
+}
+
+double Benchmark::bestSeconds(int stage) const
+{
+	return *min_element(m_seconds[stage].begin(), m_seconds[stage].end());
+}
+
+double Benchmark::meanSeconds(int stage) const
+{
+	double total = 0;
+	for (int i=0; i<m_run_num; ++i) total += m_seconds[stage][i];
+	return total / m_run_num;
+}
+
+double Benchmark::meanCPUSeconds(int stage) const
+{
+	double total = 0;
+	for (int i=0; i<m_run_num; ++i) total += m_cpu_seconds[stage][i];
+	return total / m_run_num;
+}
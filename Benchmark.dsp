@@ -0,0 +1,283 @@
+# Microsoft Developer Studio Project File - Name="Benchmark" - Package Owner=<4>
+# Microsoft Developer Studio Generated Build File, Format Version 6.00
+# ** DO NOT EDIT **
+
+# TARGTYPE "Win32 (x86) Console Application" 0x0103
+
+CFG=HMC - Win32 Debug
+!MESSAGE This is not a valid makefile. To build this project using NMAKE,
+!MESSAGE use the Export Makefile command and run
+!MESSAGE 
+!MESSAGE NMAKE /f "Benchmark.mak".
+!MESSAGE 
+!MESSAGE You can specify a configuration when running NMAKE
+!MESSAGE by defining the macro CFG on the command line. For example:
+!MESSAGE 
+!MESSAGE NMAKE /f "Benchmark.mak" CFG="Benchmark - Win32 Debug"
+!MESSAGE 
+!MESSAGE Possible choices for configuration are:
+!MESSAGE 
+!MESSAGE "Benchmark - Win32 Release" (based on "Win32 (x86) Console Application")
+!MESSAGE "Benchmark - Win32 Debug" (based on "Win32 (x86) Console Application")
+!MESSAGE 
+
+# Begin Project
+# PROP AllowPerConfigDependencies 0
+# PROP Scc_ProjName ""
+# PROP Scc_LocalPath ""
+CPP=xicl6.exe
+RSC=rc.exe
+
+!IF  "$(CFG)" == "Benchmark - Win32 Release"
+
+# PROP BASE Use_MFC 0
+# PROP BASE Use_Debug_Libraries 0
+# PROP BASE Output_Dir "Release"
+# PROP BASE Intermediate_Dir "Release"
+# PROP BASE Target_Dir ""
+# PROP Use_MFC 0
+# PROP Use_Debug_Libraries 0
+# PROP Output_Dir "Release"
+# PROP Intermediate_Dir "Release"
+# PROP Ignore_Export_Lib 0
+# PROP Target_Dir ""
+F90=df.exe
+# ADD BASE F90 /compile_only /nologo /warn:nofileopt
+# ADD F90 /browser /compile_only /nologo /warn:nofileopt
+# ADD BASE CPP /nologo /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /c
+# ADD CPP /nologo /MT /W3 /GX /O2 /D "WIN32" /D "NDEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /c
+# ADD BASE RSC /l 0x804 /d "NDEBUG"
+# ADD RSC /l 0x804 /d "NDEBUG"
+BSC32=bscmake.exe
+# ADD BASE BSC32 /nologo
+# ADD BSC32 /nologo
+LINK32=xilink6.exe
+# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:console /machine:I386
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:console /machine:I386 /opt:nowin98
+
+!ELSEIF  "$(CFG)" == "Benchmark - Win32 Debug"
+
+# PROP BASE Use_MFC 0
+# PROP BASE Use_Debug_Libraries 1
+# PROP BASE Output_Dir "Debug"
+# PROP BASE Intermediate_Dir "Debug"
+# PROP BASE Target_Dir ""
+# PROP Use_MFC 0
+# PROP Use_Debug_Libraries 1
+# PROP Output_Dir "Debug"
+# PROP Intermediate_Dir "Debug"
+# PROP Target_Dir ""
+F90=df.exe
+# ADD BASE F90 /check:bounds /compile_only /debug:full /nologo /traceback /warn:argument_checking /warn:nofileopt
+# ADD F90 /browser /check:bounds /compile_only /debug:full /nologo /traceback /warn:argument_checking /warn:nofileopt
+# ADD BASE CPP /nologo /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_CONSOLE" /D "_MBCS" /YX /FD /GZ /c
+# ADD CPP /nologo /MTd /W3 /Gm /GX /ZI /Od /D "WIN32" /D "_DEBUG" /D "_CONSOLE" /D "_MBCS" /D "_STLP_DEBUG" /YX /FD /GZ /c
+# ADD BASE RSC /l 0x804 /d "_DEBUG"
+# ADD RSC /l 0x804 /d "_DEBUG"
+BSC32=bscmake.exe
+# ADD BASE BSC32 /nologo
+# ADD BSC32 /nologo
+LINK32=xilink6.exe
+# ADD BASE LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:console /debug /machine:I386 /pdbtype:sept
+# ADD LINK32 kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib kernel32.lib user32.lib gdi32.lib winspool.lib comdlg32.lib advapi32.lib shell32.lib ole32.lib oleaut32.lib uuid.lib odbc32.lib odbccp32.lib /nologo /subsystem:console /debug /machine:I386 /pdbtype:sept
+
+!ENDIF 
+
+# Begin Target
+
+# Name "Benchmark - Win32 Release"
+# Name "Benchmark - Win32 Debug"
+# Begin Group "Source Files"
+
+# PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat;f90;for;f;fpp"
+# Begin Source File
+
+SOURCE=.\Allele.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\AlleleMatrix.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\BenchMain.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Benchmark.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Constant.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\GenoData.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Genotype.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploBuilder.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploComp.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploData.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploFile.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploLattice.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploLayer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploModel.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploPattern.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Haplotype.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\ModelFile.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Options.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\PatternManager.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\PatternTree.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\Utils.cpp
+# End Source File
+# End Group
+# Begin Group "Header Files"
+
+# PROP Default_Filter "h;hpp;hxx;hm;inl;fi;fd"
+# Begin Source File
+
+SOURCE=.\Allele.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\AlleleMatrix.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Benchmark.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Constant.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\GenoData.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Genotype.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploBuilder.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploComp.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploData.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploFile.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploLattice.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploLayer.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploModel.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploPattern.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Haplotype.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Matrix.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\MemLeak.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\ModelFile.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Parallel.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Options.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\PatternManager.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\PatternTree.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Tree.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Utils.h
+# End Source File
+# End Group
+# Begin Group "Resource Files"
+
+# PROP Default_Filter "ico;cur;bmp;dlg;rc2;rct;bin;rgs;gif;jpg;jpeg;jpe"
+# End Group
+# End Target
+# End Project
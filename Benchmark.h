@@ -0,0 +1,116 @@
+
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+
+#include <cstdio>
+#include <boost/program_options.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+#include "Utils.h"
+#include "GenoData.h"
+#include "HaploModel.h"
+
+
+namespace po = ::boost::program_options;
+
+
+// Synthetic panels for benchmarking.  Every haplotype is a mosaic of
+// founder_num founder haplotypes, jumping to a random founder at each
+// marker with probability 1/segment_len.  The founders draw the alleles of
+// a marker from one major allele and allele_num-1 equally frequent minor
+// ones, balanced so the expected heterozygosity is heterozygosity.  The
+// input genotypes are the true ones with random phases and both alleles of
+// a marker missing at missing_rate; the true ones keep these missing too,
+// so comparing counts only the observed markers.  The same seed gives the
+// same panel.
+
+class PanelGenerator {
+	boost::mt19937 m_random;
+	vector<vector<int> > m_founders;			// [founder][marker] allele index
+	double m_major_freq;
+
+public:
+	int sample_num;
+	int marker_num;
+	int allele_num;
+	int founder_num;
+	double segment_len;
+	double heterozygosity;
+	double missing_rate;
+	unsigned int seed;
+
+public:
+	PanelGenerator();
+
+	double max_heterozygosity() const { return 1.0 - 1.0 / allele_num; }
+
+	void generate(GenoData &real, GenoData &input);
+
+protected:
+	void generateFounders();
+	Allele alleleSymbol(int index) const;
+	double random() { return (m_random() + 0.5) / 4294967296.0; }
+	int random(int n) { return (int) (random() * n); }
+};
+
+
+// HaploModel with its stages exposed, so they can be timed one by one.
+
+class BenchModel : public HaploModel {
+public:
+	using HaploModel::copyParameters;
+
+	void searchPatterns(GenoData &genos) { build(genos); }
+	double resolveAll(GenoData &genos, GenoData &resolutions) { return HaploModel::resolveAll(genos, resolutions); }
+	void estimateFrequency() { m_patterns.estimateFrequency(); }
+};
+
+
+// Times pattern search, resolving, frequency estimation and comparison
+// with the true haplotypes on a synthetic panel, over a number of runs
+// each starting from a new model, and writes the timings as CSV or JSON.
+
+class Benchmark {
+	po::options_description m_options;
+	po::variables_map m_args;
+	string m_format, m_output;
+	int m_run_num;
+	bool m_header;
+
+	PanelGenerator m_generator;
+	BenchModel m_builder;
+	GenoData m_real, m_input, m_resolutions;
+
+	// the stages in the order they run
+	enum { search, resolve, estimate, compare, stage_num };
+	static const char *m_stage_names[stage_num];
+
+	vector<vector<double> > m_seconds;			// [stage][run] wall clock time
+	vector<vector<double> > m_cpu_seconds;		// [stage][run] processor time of all threads
+	double m_observed_heterozygosity;
+	double m_switch_error;
+	double m_incorrect_haplotype_percentage;
+	double m_incorrect_genotype_percentage;
+	double m_log_likelihood;
+	int m_pattern_num;
+
+public:
+	explicit Benchmark(int argc = 0, char *argv[] = NULL);
+
+	void usage();
+	void parseOptions();
+
+	void run();
+
+protected:
+	void runOnce(int run);
+	void writeCSV(FILE *fp) const;
+	void writeJSON(FILE *fp) const;
+	double bestSeconds(int stage) const;
+	double meanSeconds(int stage) const;
+	double meanCPUSeconds(int stage) const;
+};
+
+
+#endif // __BENCHMARK_H
@@ -24,25 +24,6 @@ GenoData::GenoData(int num, int len)
 	setGenotypeLen(len);
 }
 
-int GenoData::getAlleleIndex(int locus, Allele a) const
-{
-	int i;
-	bool found;
-	found = false;
-	for (i=0; i<allele_num(locus); ++i) {
-		if (a == allele_symbol(locus, i)) {
-			found = true;
-			break;
-		}
-	}
-	if (found) {
-		return i;
-	}
-	else {
-		return -1;
-	}
-}
-
 void GenoData::setGenotypeNum(int num)
 {
 	int i;
@@ -68,6 +49,7 @@ void GenoData::setGenotypeLen(int len)
 		m_allele_postition.resize(m_genotype_len);
 		m_allele_name.resize(m_genotype_len);
 		m_allele_symbol.resize(m_genotype_len);
+		m_allele_index.resize(m_genotype_len);
 		for (i=0; i<m_genotype_len; ++i) {
 			m_allele_type[i] = 'M';
 			m_allele_postition[i] = i*Constant::average_marker_distance();
@@ -75,11 +57,41 @@ void GenoData::setGenotypeLen(int len)
 	}
 }
 
+// the loci [start, start+len) of genos
+void GenoData::assign(const GenoData &genos, int start, int len)
+{
+	int i, k;
+	Haplotype h1(len), h2(len);
+	*this = GenoData();
+	setGenotypeNum(genos.genotype_num());
+	setGenotypeLen(len);
+	setUnphasedNum(genos.unphased_num());
+	for (k=0; k<len; ++k) {
+		m_allele_type[k] = genos.m_allele_type[start+k];
+		m_allele_postition[k] = genos.m_allele_postition[start+k];
+		m_allele_name[k] = genos.m_allele_name[start+k];
+	}
+	for (i=0; i<m_genotype_num; ++i) {
+		const Genotype &g = genos[i];
+		for (k=0; k<len; ++k) {
+			h1[k] = g(0)[start+k];
+			h2[k] = g(1)[start+k];
+		}
+		h1.setWeight(g(0).weight());
+		h2.setWeight(g(1).weight());
+		m_genotypes[i].setID(g.id());
+		m_genotypes[i].setHaplotypes(h1, h2);
+		m_genotypes[i].setIsPhased(g.isPhased());
+	}
+	checkAlleleSymbol();
+}
+
 void GenoData::checkAlleleSymbol()
 {
 	int i, j, k, l;
 	for (i=0; i<m_genotype_len; ++i) {
 		m_allele_symbol[i].clear();
+		m_allele_index[i].clear();
 	}
 	for (i=0; i<m_genotype_num; ++i) {
 		for (j=0; j<2; ++j) {
@@ -87,6 +99,7 @@ void GenoData::checkAlleleSymbol()
 			for (k=0; k<m_genotype_len; ++k) {
 				if (!h[k].isMissing()) {
 					if (getAlleleIndex(k, h[k]) < 0) {			// not found
+						m_allele_index[k].set(h[k], allele_num(k));
 						m_allele_symbol[k].push_back(make_pair(h[k], 0));
 					}
 				}
@@ -95,6 +108,9 @@ void GenoData::checkAlleleSymbol()
 	}
 	for (i=0; i<m_genotype_len; ++i) {
 		sort(m_allele_symbol[i].begin(), m_allele_symbol[i].end());
+		for (j=0; j<allele_num(i); ++j) {
+			m_allele_index[i].set(allele_symbol(i, j), j);
+		}
 	}
 	vector<double> total_weight;
 	total_weight.resize(m_genotype_len, 0);
@@ -25,6 +25,7 @@ protected:
 	vector<int> m_allele_postition;
 	vector<string> m_allele_name;
 	vector<vector<pair<Allele, double> > > m_allele_symbol;
+	vector<AlleleIndex> m_allele_index;
 
 public:
 	GenoData();
@@ -46,7 +47,7 @@ public:
 	double allele_frequency(int locus, int index) const { return m_allele_symbol[locus][index].second; }
 	double allele_frequency(int locus, Allele a) const { return allele_frequency(locus, getAlleleIndex(locus, a)); }
 
-	int getAlleleIndex(int locus, Allele a) const;
+	int getAlleleIndex(int locus, Allele a) const { return m_allele_index[locus].find(a); }
 
 	void setGenotypeNum(int i);
 	void setGenotypeLen(int i);
@@ -55,11 +56,13 @@ public:
 	void setAllelePosition(int locus, int position) { m_allele_postition[locus] = position; }
 	void setAlleleName(int locus, const string &name) { m_allele_name[locus] = name; string_replace(m_allele_name[locus], " ", "_"); }
 
+	void assign(const GenoData &genos, int start, int len);
 	void checkAlleleSymbol();
 	void randomizePhase();
 	void simplify();
 
 	friend class HaploData;
+	friend class ModelFile;
 };
 
 
@@ -14,7 +14,7 @@ Genotype::Genotype(const Haplotype &h1, const Haplotype &h2)
   m_missing_allele_num(0),
   m_prior_probability(0),
   m_posterior_probability(0),
-  m_genotype_probability(0),
+  m_log_genotype_probability(-HUGE_VAL),
   m_is_phased(false)
 {
 	if (h1.length() == h2.length()) {
@@ -36,7 +36,7 @@ void Genotype::setHaplotypes(Haplotype &h1, Haplotype &h2)
 	m_haplotypes[1].setID(m_id);
 	m_prior_probability = 1.0;
 	m_posterior_probability = 1.0;
-	m_genotype_probability = 1.0;
+	m_log_genotype_probability = 0;
 	m_is_phased = false;
 	checkGenotype();
 }
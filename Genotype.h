@@ -3,6 +3,7 @@
 #define __GENOTYPE_H
 
 
+#include <cmath>
 #include <string>
 
 #include "Utils.h"
@@ -18,7 +19,7 @@ protected:
 	int m_missing_allele_num;
 	double m_prior_probability;
 	double m_posterior_probability;
-	double m_genotype_probability;
+	double m_log_genotype_probability;
 	bool m_is_phased;
 
 public:
@@ -35,14 +36,14 @@ public:
 	int missing_allele_num() const { return m_missing_allele_num; }
 	double prior_probability() const { return m_prior_probability; }
 	double posterior_probability() const { return m_posterior_probability; }
-	double genotype_probability() const { return m_genotype_probability; }
+	double log_genotype_probability() const { return m_log_genotype_probability; }
 	bool isPhased() const { return m_is_phased; }
 
 	void setID(const string &id);
 	void setLength(int len) { m_haplotypes[0].setLength(len); m_haplotypes[1].setLength(len); }
 	void setPriorProbability(double p) { m_prior_probability = p; }
 	void setPosteriorProbability(double p) { m_posterior_probability = p; }
-	void setGenotypeProbability(double p) { m_genotype_probability = p; }
+	void setLogGenotypeProbability(double p) { m_log_genotype_probability = p; }
 	void setIsPhased(bool state) { m_is_phased = state; }
 	void setHaplotypes(Haplotype &h1, Haplotype &h2);
 	void checkGenotype();
@@ -86,7 +87,7 @@ inline Genotype::Genotype()
   m_missing_allele_num(0),
   m_prior_probability(0),
   m_posterior_probability(0),
-  m_genotype_probability(0),
+  m_log_genotype_probability(-HUGE_VAL),
   m_is_phased(false)
 {
 }
@@ -97,7 +98,7 @@ inline Genotype::Genotype(int len)
   m_missing_allele_num(0),
   m_prior_probability(0),
   m_posterior_probability(0),
-  m_genotype_probability(0),
+  m_log_genotype_probability(-HUGE_VAL),
   m_is_phased(false)
 {
   m_haplotypes[0].setLength(len);
@@ -27,7 +27,16 @@ HMC::HMC(int argc, char *argv[])
 		("nologo", "Suppress logo and copyright information")
 		("debug,d", po::value<int>()->default_value(4), "Set debug level")
 		("input-format,f", po::value<string>(&m_input_format)->default_value("PHASE"), "Set input file format")
+		("threads", po::value<int>(&m_builder.thread_num)->default_value(1), "Number of worker threads")
+		("window-size", po::value<int>(&m_builder.window_size)->default_value(0), "Resolve windows of this many markers separately (0 resolves all markers at once)")
+		("window-overlap", po::value<int>(&m_builder.window_overlap)->default_value(20), "Number of markers shared by adjacent windows")
 		("output-patterns", po::value<string>(), "")
+		("site-confidence", po::bool_switch(&m_builder.site_confidence), "Write the switch and imputation posteriors of each site next to the resolutions")
+		("load-model", po::value<string>(), "Phase against a saved model instead of learning one")
+		("save-model", po::value<string>(), "Save the learned model to a file")
+		("checkpoint", po::value<string>(), "Save the state of the run to a file after each iteration")
+		("resume", "Continue the run from its checkpoint")
+		("reference", po::value<vector<string> >(&m_reference_filenames), "Phase against a model learned from a phased reference panel (repeat for input formats with several files)")
 		;
 
 	po::options_description parameters("Model parameters");
@@ -39,9 +48,12 @@ HMC::HMC(int argc, char *argv[])
 		("min-pattern-len", po::value<int>(&m_builder.min_pattern_len)->default_value(1), "Minimum length of patterns")
 		("max-pattern-len", po::value<int>(&m_builder.max_pattern_len)->default_value(30), "Maximum length of patterns")
 		("mc-order,o", po::value<int>(&m_builder.mc_order)->default_value(1), "Markov chain order")
+		("beam-width", po::value<int>(&m_builder.beam_width)->default_value(0), "Keep at most this many haplotype pairs per locus (0 keeps all)")
+		("beam-ratio", po::value<double>(&m_builder.beam_ratio)->default_value(0), "Drop haplotype pairs less likely than this ratio of the best one")
 		("exact-estimate", po::bool_switch(&m_builder.exact_estimate), "Re-estimate frequency exactly (i.e. not using sampling)")
 		("sample-size", po::value<int>(&m_builder.sample_size)->default_value(10), "Sample some most probable configurations")
 		("max-sample-size", po::value<int>(&m_builder.max_sample_size), "Maximum sample size")
+		("posterior-samples", po::value<int>(&m_builder.posterior_samples)->default_value(0), "Draw this many configurations from the posterior instead of sampling the most probable ones (0 disables)")
 		("final-sample-size", po::value<int>(&m_builder.final_sample_size)->default_value(1), "Final sample size")
 		("max-iteration,i", po::value<int>(&m_builder.max_iteration)->default_value(1), "Maximum iteration number")
 		("min-iteration", po::value<int>(&m_builder.min_iteration)->default_value(-1), "Minimum iteration number")
@@ -80,6 +92,10 @@ HMC::HMC(int argc, char *argv[])
 	conflicting_options(m_args, "convert", "compare");
 	conflicting_options(m_args, "min-freq", "num-patterns");
 	conflicting_options(m_args, "min-freq-abs", "num-patterns");
+	conflicting_options(m_args, "reference", "load-model");
+	conflicting_options(m_args, "checkpoint", "load-model");
+	conflicting_options(m_args, "checkpoint", "reference");
+	option_dependency(m_args, "resume", "checkpoint");
 
 	parseOptions();
 	parseFileNames();
@@ -136,6 +152,11 @@ void HMC::parseOptions()
 		exit(1);
 	}
 
+	if (m_builder.window_size > 0 && (m_builder.window_overlap <= 0 || m_builder.window_overlap >= m_builder.window_size)) {
+		Logger::error("The value of option --window-overlap must be positive and less than that of option --window-size!");
+		exit(1);
+	}
+
 	m_builder.setModel(m_args["model"].as<string>());
 }
 
@@ -174,6 +195,13 @@ void HMC::parseFileNames()
 	else if (m_args.count("compare")) {
 		m_target_file.reset(HaploFile::getHaploFile(m_input_format, m_filenames.begin()+ni));
 	}
+	if (m_args.count("reference")) {
+		if (m_reference_filenames.size() != ni) {
+			Logger::error("Input format %s require %d reference filenames!", m_input_format.c_str(), ni);
+			exit(1);
+		}
+		m_reference_file.reset(HaploFile::getHaploFile(m_input_format, m_reference_filenames.begin()));
+	}
 }
 
 void HMC::run()
@@ -197,6 +225,28 @@ void HMC::run()
 
 void HMC::resolve()
 {
+	if (m_args.count("load-model")) {
+		m_builder.loadModel(m_args["load-model"].as<string>());
+	}
+	else if (m_args.count("reference")) {
+		GenoData reference;
+		Logger::info("Reading reference file ...");
+		m_reference_file->readGenoData(reference);
+		Logger::info("Succesfully read reference file with %d markers and %d genotypes.",
+						reference.genotype_len(), reference.genotype_num());
+		m_builder.buildReference(reference);
+	}
+	bool fixed = m_args.count("load-model") || m_args.count("reference");
+	bool windowed = !fixed && m_builder.window_size > 0 && m_genos.genotype_len() > m_builder.window_size;
+	if (m_args.count("checkpoint")) {
+		if (windowed) {
+			Logger::warning("Checkpoints are not written when resolving in windows!");
+		}
+		else {
+			m_builder.setCheckpoint(m_args["checkpoint"].as<string>(), m_args.count("resume") > 0);
+		}
+	}
+
 	Logger::debug("");
 	Logger::beginTimer(3, "Find bottleneck");
 	Logger::beginTimer(4, "Find bottleneck");
@@ -216,6 +266,9 @@ void HMC::resolve()
 	Logger::debug("");
 	Logger::endTimer(2);
 	Logger::info("Solving Time = %f", Logger::timer(1).time()+Logger::timer(2).time());
+	if (fixed && Logger::timer(2).time() > 0) {
+		Logger::info("Phasing Rate = %f genotypes per second", m_genos.genotype_num() / Logger::timer(2).time());
+	}
 
 // 	for (i=0; i<m_genos.unphased_num(); i++) {
 // 		double w1, w2, w3;
@@ -228,7 +281,34 @@ void HMC::resolve()
 	m_input_file->writeGenoData(m_resolutions, ".reconstructed");
 	if (m_args.count("output-patterns"))
 	{
-		m_input_file->writePattern(m_builder, ".patterns");
+		if (windowed) {
+			Logger::warning("Patterns are not written when resolving in windows!");
+		}
+		else if (m_args.count("load-model")) {
+			Logger::warning("Patterns are not written when phasing against a loaded model!");
+		}
+		else if (m_args.count("reference")) {
+			m_reference_file->writePattern(m_builder, ".patterns");
+		}
+		else {
+			m_input_file->writePattern(m_builder, ".patterns");
+		}
+	}
+	if (m_builder.site_confidence) {
+		if (windowed) {
+			Logger::warning("Site confidence is not written when resolving in windows!");
+		}
+		else {
+			m_input_file->writeConfidence(m_genos, m_builder.confidence(), ".confidence");
+		}
+	}
+	if (m_args.count("save-model")) {
+		if (windowed) {
+			Logger::warning("The model is not saved when resolving in windows!");
+		}
+		else {
+			m_builder.saveModel(m_args["save-model"].as<string>());
+		}
 	}
 }
 
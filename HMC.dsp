@@ -96,6 +96,10 @@ SOURCE=.\Allele.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\AlleleMatrix.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Constant.cpp
 # End Source File
 # Begin Source File
@@ -124,11 +128,15 @@ SOURCE=.\HaploFile.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\HaploModel.cpp
+SOURCE=.\HaploLattice.cpp
 # End Source File
 # Begin Source File
 
-SOURCE=.\HaploPair.cpp
+SOURCE=.\HaploLayer.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploModel.cpp
 # End Source File
 # Begin Source File
 
@@ -148,6 +156,10 @@ SOURCE=.\Main.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\ModelFile.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\Options.cpp
 # End Source File
 # Begin Source File
@@ -172,6 +184,10 @@ SOURCE=.\Allele.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\AlleleMatrix.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Constant.h
 # End Source File
 # Begin Source File
@@ -200,11 +216,15 @@ SOURCE=.\HaploFile.h
 # End Source File
 # Begin Source File
 
-SOURCE=.\HaploModel.h
+SOURCE=.\HaploLattice.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\HaploLayer.h
 # End Source File
 # Begin Source File
 
-SOURCE=.\HaploPair.h
+SOURCE=.\HaploModel.h
 # End Source File
 # Begin Source File
 
@@ -228,6 +248,14 @@ SOURCE=.\MemLeak.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\ModelFile.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\Parallel.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\Options.h
 # End Source File
 # Begin Source File
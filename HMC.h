@@ -21,8 +21,9 @@ class HMC {
 	po::options_description m_visible_options;
 	po::variables_map m_args;
 	vector<string> m_filenames;
+	vector<string> m_reference_filenames;
 	string m_input_format, m_convert_format;
-	tr1::shared_ptr<HaploFile> m_input_file, m_target_file;
+	tr1::shared_ptr<HaploFile> m_input_file, m_target_file, m_reference_file;
 
 	HaploModel m_builder;
 	GenoData m_genos;
@@ -1,128 +1,54 @@
 
 #include "HaploBuilder.h"
-#include "HaploPair.h"
+#include "HaploLayer.h"
 #include "GenoData.h"
+#include "Parallel.h"
+
+#include <cmath>
 
 #include "MemLeak.h"
 
 
+// a pattern tree node waiting to be visited, reached through allele index allele
+struct PatternEntry {
+	PatternNode *node;
+	int depth;
+	int allele;
+
+	PatternEntry(PatternNode *n, int d, int a) : node(n), depth(d), allele(a) { }
+};
+
+
 HaploBuilder::HaploBuilder()
-: m_patterns(*this), m_sample_size(1)
+: m_patterns(*this),
+  thread_num(1),
+  beam_width(0),
+  beam_ratio(0)
 {
 }
 
 HaploBuilder::~HaploBuilder()
 {
-	for_each(m_haplopairs.begin(), m_haplopairs.end(), DeleteAll_Clear());
+	DeleteAll_Clear()(m_lattices);
 }
 
 void HaploBuilder::setGenoData(GenoData &genos)
 {
 	m_genos = &genos;
-	m_samples.clear();
+	m_samples.reset(genos);
 }
 
-void HaploBuilder::initialize()
+HaploLattice &HaploBuilder::lattice(int i)
 {
-	for_each(m_haplopairs.begin(), m_haplopairs.end(), DeleteAll_Clear());
-	m_haplopairs.resize(genotype_len()+1);
-	m_best_pair.resize(pattern_num());
-	for (int i=0; i<pattern_num(); ++i) {
-		m_best_pair[i].clear();
+	while (m_lattices.size() <= i) {
+		m_lattices.push_back(new HaploLattice(*this));
 	}
+	return *m_lattices[i];
 }
 
 double HaploBuilder::resolve(const Genotype &genotype, Genotype &resolution, vector<Genotype> &res_list, int sample_size)
 {
-	int pn = pattern_num();
-	int head_len = m_patterns.head_len();
-	int i, j, k, n;
-	Allele a, b;
-	double total_likelihood, coverage;
-	vector<HaploPairLink> res_link;
-	vector<HaploPair*>::iterator i_hp;
-	m_sample_size = sample_size > 1 ? sample_size : 1;
-	initialize();
-	initHeadList(genotype);
-	for (i=head_len; i<genotype_len(); ++i) {
-		if (genotype.isMissing(i)) {
-			for (j=0; j<m_genos->allele_num(i); ++j) {
-				if (m_genos->allele_frequency(i, j) > 0) {
-					for (k=j; k<m_genos->allele_num(i); ++k) {
-						if (m_genos->allele_frequency(i, k) > 0) {
-							a = m_genos->allele_symbol(i, j);
-							b = m_genos->allele_symbol(i, k);
-							extendAll(i, a, b);
-						}
-					}
-				}
-			}
-		}
-		else if (genotype(0)[i].isMissing()) {
-			for (j=0; j<m_genos->allele_num(i); ++j) {
-				if (m_genos->allele_frequency(i, j) > 0) {
-					a = m_genos->allele_symbol(i, j);
-					extendAll(i, a, genotype(1)[i]);
-				}
-			}
-		}
-		else if (genotype(1)[i].isMissing()) {
-			for (j=0; j<m_genos->allele_num(i); ++j) {
-				if (m_genos->allele_frequency(i, j) > 0) {
-					a = m_genos->allele_symbol(i, j);
-					extendAll(i, a, genotype(0)[i]);
-				}
-			}
-		}
-		else {
-			extendAll(i, genotype(0)[i], genotype(1)[i]);
-		}
-		if (m_haplopairs[i+1].size() <= 0) {
-			break;
-		}
-		else {
-			for_each(m_haplopairs[i+1].begin(), m_haplopairs[i+1].end(), HaploPair::pack_size());
-		}
-	}
-	if (m_haplopairs[genotype_len()].size() > 0) {
-		total_likelihood = 0;
-		res_link.clear();
-		for (i_hp = m_haplopairs[genotype_len()].begin(); i_hp != m_haplopairs[genotype_len()].end(); ++i_hp) {
-			total_likelihood += (*i_hp)->forward_likelihood();
-			k = res_link.size();
-			n = (*i_hp)->best_links().size();
-			res_link.insert(res_link.end(), (*i_hp)->best_links().begin(), (*i_hp)->best_links().end());
-			for (i=k; i<k+n; ++i) {
-				res_link[i].link = (*i_hp);
-				res_link[i].index = i-k;
-				if (!res_link[i].homozygous) res_link[i].likelihood *= 2.0;
-			}
-			if (res_link.size() > m_sample_size) {
-				nth_element(res_link.begin(), res_link.begin()+m_sample_size-1, res_link.end(), greater<HaploPairLink>());
-				res_link.resize(m_sample_size);
-			}
-		}
-		sort(res_link.begin(), res_link.end(), greater<HaploPairLink>());
-		coverage = 0;
-		res_list.clear();
-		n = res_link.size();
-		for (i=0; i<n; ++i) {
-			res_list.push_back(res_link[i].link->getGenotype(res_link[i].index));
-			res_list[i].setPosteriorProbability(res_list[i].prior_probability() / total_likelihood);
-			res_list[i].setGenotypeProbability(total_likelihood);
-			coverage += res_list[i].posterior_probability();
-		}
-		resolution = res_list.front();
-	}
-	else {
-		coverage = 0;
-		res_list.clear();
-		resolution = genotype;
-		resolution.setPriorProbability(0);
-		resolution.setPosteriorProbability(0);
-		resolution.setGenotypeProbability(0);
-	}
-	return coverage;
+	return lattice().resolve(genotype, resolution, res_list, sample_size);
 }
 
 double HaploBuilder::getLikelihood(const Haplotype &haplotype)
@@ -150,175 +76,71 @@ double HaploBuilder::getLikelihood(const Genotype &genotype)
 	return getLikelihood(genotype(0)) * getLikelihood(genotype(1));
 }
 
-void HaploBuilder::initHeadList(const Genotype &genotype)
-{
-	int head_len = m_patterns.head_len();
-	const vector<HaploPattern*> &head_list = m_patterns.head_list();
-	const BackwardPatternTree *pattern_tree = m_patterns.pattern_tree();
-	vector<AlleleSequence*> new_list, last_list;
-	vector<AlleleSequence*>::iterator i_as;
-	vector<HaploPattern*>::const_iterator head;
-	for (head = head_list.begin(); head != head_list.end(); ++head) {
-		if ((*head)->isMatch(genotype)) {
-			last_list.push_back(new AlleleSequence);
-			for (int j=0; j<head_len; ++j) {
-				i_as = last_list.begin();
-				if (genotype.isMissing(j) || (genotype.hasMissing(j) && genotype.hasAllele(j, (**head)[j]))) {
-					while (i_as != last_list.end()) {
-						AlleleSequence *as = *i_as;
-						for (int k=0; k<m_genos->allele_num(j); ++k) {
-							if (m_genos->allele_frequency(j, k) > 0) {
-								AlleleSequence *new_as = new AlleleSequence;
-								new_as->assign(*as, m_genos->allele_symbol(j, k));
-								new_list.push_back(new_as);
-							}
-						}
-						++i_as;
-					}
-				}
-				else if (genotype.isHeterozygous(j)) {
-					while (i_as != last_list.end()) {
-						AlleleSequence *as = *i_as;
-						AlleleSequence *new_as = new AlleleSequence;
-						if ((**head)[j] == genotype(0)[j]) {
-							new_as->assign(*as, genotype(1)[j]);
-						}
-						else {
-							new_as->assign(*as, genotype(0)[j]);
-						}
-						new_list.push_back(new_as);
-						++i_as;
-					}
-				}
-				else {
-					while (i_as != last_list.end()) {
-						AlleleSequence *as = *i_as;
-						AlleleSequence *new_as = new AlleleSequence;
-						new_as->assign(*as, genotype(0)[j]);
-						new_list.push_back(new_as);
-						++i_as;
-					}
-				}
-				DeleteAll_Clear()(last_list);
-				last_list.swap(new_list);
-			}
-			i_as = last_list.begin();
-			while (i_as != last_list.end()) {
-				HaploPattern *hp = pattern_tree->findLongestMatchPattern(head_len, *i_as);
-				if (hp && hp->start() == 0) {
-					if (hp->id() >= (*head)->id()) {
-						HaploPair *new_hp = new HaploPair(*head, hp);
-						m_haplopairs[head_len].push_back(new_hp);
-				 		m_best_pair[new_hp->id_a()].insert(make_pair(new_hp->id_b(), m_haplopairs[head_len].size()));
-					}
-				}
-				else {
-					Logger::error("Can not find matching pattern!");
-					exit(1);
-				}
-				++i_as;
-			}
-			DeleteAll_Clear()(last_list);
-		}
-	}
-}
+// Estimates the frequencies for a block of genotypes into its own
+// arrays, which estimateFrequency() adds up in worker order.
+class FrequencyWorker {
+	const HaploBuilder &m_builder;
+	HaploLattice &m_lattice;
+	ForwardPatternTree &m_tree;
+	int m_first, m_last;
+	vector<PairWeights> m_match;
 
-void HaploBuilder::extendAll(int i, Allele a1, Allele a2)
-{
-	vector<HaploPair*>::iterator i_hp;
-	for (i_hp = m_haplopairs[i].begin(); i_hp != m_haplopairs[i].end(); ++i_hp) {
-		extend(*i_hp, a1, a2);
-		if (a1 != a2) extend(*i_hp, a2, a1);
-	}
-}
+public:
+	vector<double> frequency, prefix_freq;
 
-void HaploBuilder::extend(HaploPair *hp, Allele a1, Allele a2)
-{
-	if (hp->forward_likelihood() <= 0) return;
-	const HaploPattern *hpa, *hpb;
-	hpa = hp->successor_a(a1);
-	hpb = hp->successor_b(a2);
-	if (hpa && hpb) {
-		addHaploPair(hp, hpa, hpb);
-	}
-}
+	FrequencyWorker(const HaploBuilder &hb, HaploLattice &hl, ForwardPatternTree &tree, int first, int last, int pattern_num)
+		: m_builder(hb), m_lattice(hl), m_tree(tree), m_first(first), m_last(last),
+		  frequency(pattern_num, 0), prefix_freq(pattern_num, 0) { }
 
-void HaploBuilder::addHaploPair(HaploPair *hp, const HaploPattern *hpa, const HaploPattern *hpb)
-{
-	bool reversed = false;
-	if (hpa->id() > hpb->id()) {
-		reversed = true;
-		swap(hpa, hpb);
-	}
-	map<int, int>::iterator i = m_best_pair[hpa->id()].lower_bound(hpb->id());
-	if (i == m_best_pair[hpa->id()].end() || (*i).first != hpb->id()) {
-		m_haplopairs[hp->end()+1].push_back(new HaploPair(hpa, hpb, hp, reversed));
-	 	m_best_pair[hpa->id()].insert(i, make_pair(hpb->id(), m_haplopairs[hp->end()+1].size()));
-	}
-	else {
-		m_haplopairs[hp->end()+1][(*i).second-1]->add(hp, reversed, m_sample_size);
-	}
-}
+	void operator()();
+};
 
-void HaploBuilder::calcBackwardLikelihood()
+void FrequencyWorker::operator()()
 {
-	int head_len = m_patterns.head_len();
-	vector<HaploPair*>::iterator i_hp;
-	for (int i=genotype_len()-1; i>=head_len; --i) {
-		for (i_hp=m_haplopairs[i].begin(); i_hp!=m_haplopairs[i].end(); ++i_hp) {
-			(*i_hp)->calcBackwardLikelihood();
+	Genotype res;
+	vector<Genotype> res_list;
+	int geno, start;
+	for (geno=m_first; geno<m_last; ++geno) {
+		m_lattice.resolve((*m_builder.genos())[geno], res, res_list);
+		m_lattice.calcBackwardLikelihood();
+		double probability = m_lattice.likelihood();
+		for (start=0; start<m_builder.genotype_len(); ++start) {
+			m_builder.estimateFrequency(m_lattice, m_tree.root(start), start, probability, m_match, frequency, prefix_freq);
 		}
 	}
 }
 
+// patterns are numbered by setID to index the frequency arrays of the workers
 void HaploBuilder::estimateFrequency(vector<HaploPattern*> &patterns)
 {
-	int i, n;
-	int start, geno;
-	Genotype res;
-	vector<Genotype> res_list;
+	int i, k, n;
 	ForwardPatternTree tree(*m_genos);
-	map<HaploPair*, double> match_list[3];
 
 	n = patterns.size();
 	for (i=0; i<n; ++i) {
 		HaploPattern *hp = patterns[i];
+		hp->setID(i);
 		tree.addPattern(hp);
-		hp->setFrequency(0);
-		hp->setPrefixFreq(0);
 	}
 
-	for (geno=0; geno<genotype_num(); ++geno) {
-		resolve((*m_genos)[geno], res, res_list);
-		calcBackwardLikelihood();
-		m_current_genotype_probability = (*m_genos)[geno].genotype_probability();
-
-		for (start=0; start<genotype_len(); ++start) {
-			match_list[0].clear();
-			match_list[1].clear();
-
-			int end = max(start, m_patterns.head_len());
-			n = m_haplopairs[end].size();
-			for (i=0; i<n; ++i) {
-				HaploPair *hp = m_haplopairs[end][i];
-				match_list[0][hp] = hp->forward_likelihood();
-			}
-
-			PatternNode *node = tree.root(start);
-			n = node->size();
-			for (i=0; i<node->size(); ++i) {
-				if (node->getChild(i)) {
-					estimateFrequency(node->getChild(i), start, m_genos->allele_symbol(start, i), 1.0, match_list);
-				}
-			}
-		}
+	// fixed blocks of genotypes, so the sums do not depend on scheduling
+	int worker_num = max(1, min(thread_num, genotype_num()));
+	vector<FrequencyWorker*> workers;
+	for (k=0; k<worker_num; ++k) {
+		workers.push_back(new FrequencyWorker(*this, lattice(k), tree,
+			k * genotype_num() / worker_num, (k+1) * genotype_num() / worker_num, n));
 	}
+	run_parallel(workers);
 
-	n = patterns.size();
 	for (i=0; i<n; ++i) {
 		HaploPattern *hp = patterns[i];
-		double freq = min(hp->frequency(), genotype_num());
-		double prefix_freq = min(hp->prefix_freq(), genotype_num());
+		double freq = 0, prefix_freq = 0;
+		for (k=0; k<worker_num; ++k) {
+			freq += workers[k]->frequency[i];
+			prefix_freq += workers[k]->prefix_freq[i];
+		}
+		freq = min(freq, genotype_num());
+		prefix_freq = min(prefix_freq, genotype_num());
 		freq = min(freq, prefix_freq);
 		hp->setFrequency(freq / genotype_num());
 		hp->setPrefixFreq(prefix_freq / genotype_num());
@@ -329,122 +151,154 @@ void HaploBuilder::estimateFrequency(vector<HaploPattern*> &patterns)
 			hp->setTransitionProb(freq / genotype_num());
 		}
 	}
+	DeleteAll_Clear()(workers);
 }
 
-double HaploBuilder::estimateFrequency(PatternNode *node, int locus, const Allele &a, double last_freq, const map<HaploPair*, double> last_match[3])
+// Walk the pattern tree of start depth first without recursion.
+// match[3*d .. 3*d+2] hold the weights of the pairs matching the node at
+// depth d on both chromosomes, on the first only, and on the second only;
+// they are kept across calls so the buffers are allocated once.
+void HaploBuilder::estimateFrequency(const HaploLattice &hl, PatternNode *root, int start, double probability,
+									 vector<PairWeights> &match, vector<double> &frequency, vector<double> &prefix_freq) const
 {
-	map<HaploPair*, double> match_list[3];
-	map<HaploPair*, double>::const_iterator i_mp;
-	vector<HaploPair*>::const_iterator i_link;
-	HaploPair *last_hp, *hp;
-	double weight;
-	int i;
+	vector<PatternEntry> stack;
+	vector<double> node_freq;
+	PatternNode *node;
+	int i, j, k, t, n, depth, locus;
+	double weight, p, factor, freq;
+
+	int end = max(start, m_patterns.head_len());
+	const HaploLayer &first = hl.layer(end);
+	if (match.size() < 3) match.resize(3);
+	n = first.size();
+	for (t=0; t<3; ++t) match[t].reset(n);
+	for (j=0; j<n; ++j) {
+		match[0].add(j, first.forward_likelihood[j]);
+	}
+	node_freq.push_back(1.0);
 
-	if (locus < m_patterns.head_len()) {
-		for (i_mp=last_match[0].begin(); i_mp!=last_match[0].end(); ++i_mp) {
-			hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			if (hp->pattern_a()[locus] == a) {
-				if (hp->pattern_b()[locus] == a) {
-					match_list[0][hp] += weight;
+	for (i=root->size()-1; i>=0; --i) {
+		if (root->getChild(i)) stack.push_back(PatternEntry(root->getChild(i), 1, i));
+	}
+	while (!stack.empty()) {
+		node = stack.back().node;
+		depth = stack.back().depth;
+		locus = start + depth - 1;
+		Allele a = m_genos->allele_symbol(locus, stack.back().allele);
+		stack.pop_back();
+		if (match.size() < 3*(depth+1)) match.resize(3*(depth+1));
+		const PairWeights *last_match = &match[3*(depth-1)];
+		PairWeights *match_list = &match[3*depth];
+		const HaploLayer &next = hl.layer(max(locus+1, m_patterns.head_len()));
+		n = next.size();
+		for (t=0; t<3; ++t) match_list[t].reset(n);
+
+		if (locus < m_patterns.head_len()) {
+			for (i=0; i<last_match[0].index.size(); ++i) {
+				j = last_match[0].index[i];
+				weight = last_match[0].weight[j];
+				if ((*next.pattern_a[j])[locus] == a) {
+					if ((*next.pattern_b[j])[locus] == a) {
+						match_list[0].add(j, weight);
+					}
+					else {
+						match_list[1].add(j, weight * 0.5);
+					}
 				}
-				else {
-					match_list[1][hp] += weight * 0.5;
+				else if ((*next.pattern_b[j])[locus] == a) {
+					match_list[2].add(j, weight * 0.5);
 				}
 			}
-			else if (hp->pattern_b()[locus] == a) {
-				match_list[2][hp] += weight * 0.5;
-			}
-		}
-		for (i_mp=last_match[1].begin(); i_mp!=last_match[1].end(); ++i_mp) {
-			hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			if (hp->pattern_a()[locus] == a) {
-				match_list[1][hp] += weight;
+			for (i=0; i<last_match[1].index.size(); ++i) {
+				j = last_match[1].index[i];
+				if ((*next.pattern_a[j])[locus] == a) {
+					match_list[1].add(j, last_match[1].weight[j]);
+				}
 			}
-		}
-		for (i_mp=last_match[2].begin(); i_mp!=last_match[2].end(); ++i_mp) {
-			hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			if (hp->pattern_b()[locus] == a) {
-				match_list[2][hp] += weight;
+			for (i=0; i<last_match[2].index.size(); ++i) {
+				j = last_match[2].index[i];
+				if ((*next.pattern_b[j])[locus] == a) {
+					match_list[2].add(j, last_match[2].weight[j]);
+				}
 			}
 		}
-	}
-	else {
-		for (i_mp=last_match[0].begin(); i_mp!=last_match[0].end(); ++i_mp) {
-			last_hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			for (i=0; i<2; ++i) {
-				for (i_link=last_hp->forward_links(i).begin(); i_link!=last_hp->forward_links(i).end(); ++i_link) {
-					hp = *i_link;
-					if (hp->allele_a() == a) {
-						if (hp->allele_b() == a) {
-							match_list[0][hp] += weight * hp->transition_prob();
+		else {
+			const HaploLayer &last = hl.layer(locus);
+			factor = ldexp(1.0, -next.scale);
+			for (i=0; i<last_match[0].index.size(); ++i) {
+				j = last_match[0].index[i];
+				weight = last_match[0].weight[j];
+				for (t=last.forward_begin(j); t<last.reversed_end(j); ++t) {
+					k = last.link_target[t];
+					p = next.transition_prob[k] * factor;
+					if (next.allele_a[k] == a) {
+						if (next.allele_b[k] == a) {
+							match_list[0].add(k, weight * p);
 						}
 						else {
-							match_list[1][hp] += weight * hp->transition_prob() * 0.5;
+							match_list[1].add(k, weight * p * 0.5);
 						}
 					}
-					else if (hp->allele_b() == a) {
-						match_list[2][hp] += weight * hp->transition_prob() * 0.5;
+					else if (next.allele_b[k] == a) {
+						match_list[2].add(k, weight * p * 0.5);
 					}
 				}
 			}
-		}
-		for (i_mp=last_match[1].begin(); i_mp!=last_match[1].end(); ++i_mp) {
-			last_hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			for (i_link=last_hp->forward_links(0).begin(); i_link!=last_hp->forward_links(0).end(); ++i_link) {
-				hp = *i_link;
-				if (hp->allele_a() == a) {
-					match_list[1][hp] += weight * hp->transition_prob();
+			for (i=0; i<last_match[1].index.size(); ++i) {
+				j = last_match[1].index[i];
+				weight = last_match[1].weight[j];
+				for (t=last.forward_begin(j); t<last.forward_end(j); ++t) {
+					k = last.link_target[t];
+					if (next.allele_a[k] == a) {
+						match_list[1].add(k, weight * next.transition_prob[k] * factor);
+					}
 				}
-			}
-			for (i_link=last_hp->forward_links(1).begin(); i_link!=last_hp->forward_links(1).end(); ++i_link) {
-				hp = *i_link;
-				if (hp->allele_b() == a) {
-					match_list[2][hp] += weight * hp->transition_prob();
+				for (t=last.reversed_begin(j); t<last.reversed_end(j); ++t) {
+					k = last.link_target[t];
+					if (next.allele_b[k] == a) {
+						match_list[2].add(k, weight * next.transition_prob[k] * factor);
+					}
 				}
 			}
-		}
-		for (i_mp=last_match[2].begin(); i_mp!=last_match[2].end(); ++i_mp) {
-			last_hp = (*i_mp).first;
-			weight = (*i_mp).second;
-			for (i_link=last_hp->forward_links(0).begin(); i_link!=last_hp->forward_links(0).end(); ++i_link) {
-				hp = *i_link;
-				if (hp->allele_b() == a) {
-					match_list[2][hp] += weight * hp->transition_prob();
+			for (i=0; i<last_match[2].index.size(); ++i) {
+				j = last_match[2].index[i];
+				weight = last_match[2].weight[j];
+				for (t=last.forward_begin(j); t<last.forward_end(j); ++t) {
+					k = last.link_target[t];
+					if (next.allele_b[k] == a) {
+						match_list[2].add(k, weight * next.transition_prob[k] * factor);
+					}
 				}
-			}
-			for (i_link=last_hp->forward_links(1).begin(); i_link!=last_hp->forward_links(1).end(); ++i_link) {
-				hp = *i_link;
-				if (hp->allele_a() == a) {
-					match_list[1][hp] += weight * hp->transition_prob();
+				for (t=last.reversed_begin(j); t<last.reversed_end(j); ++t) {
+					k = last.link_target[t];
+					if (next.allele_a[k] == a) {
+						match_list[1].add(k, weight * next.transition_prob[k] * factor);
+					}
 				}
 			}
 		}
-	}
 
-	double freq = 0;
-	for (i=0; i<3; ++i) {
-		for (i_mp=match_list[i].begin(); i_mp!=match_list[i].end(); ++i_mp) {
-			freq += (*i_mp).second * (*i_mp).first->backward_likelihood();
+		// pairs in index order, so the sums do not depend on the link order
+		freq = 0;
+		for (t=0; t<3; ++t) {
+			match_list[t].sort();
+			for (i=0; i<match_list[t].index.size(); ++i) {
+				j = match_list[t].index[i];
+				freq += match_list[t].weight[j] * next.backward_likelihood[j];
+			}
 		}
-	}
-	freq /= m_current_genotype_probability;
+		freq /= probability;
 
-	if (node->data()) {
-		HaploPattern *hp = node->data();
-		hp->setFrequency(hp->frequency() + freq);
-		hp->setPrefixFreq(hp->prefix_freq() + last_freq);
-	}
+		if (node->data()) {
+			i = node->data()->id();
+			frequency[i] += freq;
+			prefix_freq[i] += node_freq[depth-1];
+		}
 
-	for (i=0; i<node->size(); ++i) {
-		if (node->getChild(i)) {
-			estimateFrequency(node->getChild(i), locus+1, m_genos->allele_symbol(locus+1, i), freq, match_list);
+		node_freq.resize(depth+1);
+		node_freq[depth] = freq;
+		for (i=node->size()-1; i>=0; --i) {
+			if (node->getChild(i)) stack.push_back(PatternEntry(node->getChild(i), depth+1, i));
 		}
 	}
-
-	return freq;
 }
@@ -11,24 +11,29 @@
 #include "Constant.h"
 #include "Allele.h"
 #include "HaploPattern.h"
-#include "HaploPair.h"
+#include "HaploLayer.h"
+#include "HaploLattice.h"
 #include "HaploData.h"
 #include "PatternTree.h"
 #include "PatternManager.h"
 
 
 class HaploBuilder {
+	friend class FrequencyWorker;
+	friend class ModelFile;
+
 protected:
 	GenoData *m_genos;
 	PatternManager m_patterns;
 
 	HaploData m_samples;
-	int m_sample_size;
 
-	vector<vector<HaploPair*> > m_haplopairs;
-	vector<map<int, int> > m_best_pair;
+	vector<HaploLattice*> m_lattices;
 
-	double m_current_genotype_probability;
+public:
+	int thread_num;
+	int beam_width;
+	double beam_ratio;
 
 public:
 	HaploBuilder();
@@ -37,6 +42,7 @@ public:
 	GenoData *genos() { return m_genos; }
 	const GenoData *genos() const { return m_genos; }
 	const HaploPattern *patterns(int i) const { return m_patterns[i]; }
+	const PatternManager &pattern_manager() const { return m_patterns; }
 	HaploData *samples() { return &m_samples; }
 	const HaploData *samples() const { return &m_samples; }
 
@@ -46,6 +52,8 @@ public:
 
 	void setGenoData(GenoData &genos);
 
+	HaploLattice &lattice(int i = 0);
+
 	double resolve(const Genotype &genotype, Genotype &resolution, vector<Genotype> &res_list, int sample_size = 1);
 
 	double getLikelihood(const Haplotype &haplotype);
@@ -54,17 +62,8 @@ public:
 	void estimateFrequency(vector<HaploPattern*> &patterns);
 
 protected:
-	void clear();
-	void clearHaploPairs();
-	void initialize();
-	void initHeadList(const Genotype &genotype);
-
-	void extendAll(int i, Allele a1, Allele a2);
-	void extend(HaploPair *hp, Allele a1, Allele a2);
-	void addHaploPair(HaploPair *hp, const HaploPattern *hpa, const HaploPattern *hpb);
-
-	void calcBackwardLikelihood();
-	double estimateFrequency(PatternNode *node, int locus, const Allele &a, double last_freq, const map<HaploPair*, double> last_match[3]);
+	void estimateFrequency(const HaploLattice &hl, PatternNode *root, int start, double probability,
+		vector<PairWeights> &match, vector<double> &frequency, vector<double> &prefix_freq) const;
 };
 
 
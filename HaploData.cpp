@@ -10,173 +10,258 @@
 
 HaploData::HaploData()
 : m_haplotype_num(0),
-  m_haplotype_len(0)
+  m_haplotype_len(0),
+  m_total_weight(0)
 {
 }
 
 HaploData::HaploData(int num, int len)
 : m_haplotype_num(0),
-  m_haplotype_len(0)
+  m_haplotype_len(0),
+  m_total_weight(0)
 {
 	setHaplotypeNum(num);
 	setHaplotypeLen(len);
 }
 
 HaploData::HaploData(const GenoData &genos)
-: m_haplotype_num(genos.genotype_num() * 2),
-  m_haplotype_len(genos.genotype_len()),
-  m_allele_type(genos.m_allele_type),
-  m_allele_postition(genos.m_allele_postition),
-  m_allele_name(genos.m_allele_name),
-  m_allele_symbol(genos.m_allele_symbol)
-{
-	m_haplotypes.resize(m_haplotype_num);
+: m_haplotype_num(0),
+  m_haplotype_len(0),
+  m_total_weight(0)
+{
+	(*this) = genos;
+}
+
+HaploData &HaploData::operator =(const GenoData &genos)
+{
+	reset(genos);
+	setHaplotypeNum(genos.genotype_num() * 2);
 	for (int i=0; i<genos.genotype_num(); ++i) {
-		m_haplotypes[2*i] = genos[i](0);
-		m_haplotypes[2*i+1] = genos[i](1);
+		setHaplotype(2*i, genos[i](0));
+		setHaplotype(2*i+1, genos[i](1));
 	}
+	return *this;
 }
 
-HaploData &HaploData::operator =(const GenoData &genos)
+// drop all haplotypes and take the loci and allele symbols of genos
+void HaploData::reset(const GenoData &genos)
 {
-	m_haplotype_num = genos.genotype_num() * 2;
+	m_haplotype_num = 0;
 	m_haplotype_len = genos.genotype_len();
 	m_allele_type = genos.m_allele_type;
 	m_allele_postition = genos.m_allele_postition;
 	m_allele_name = genos.m_allele_name;
 	m_allele_symbol = genos.m_allele_symbol;
-	m_haplotypes.resize(m_haplotype_num);
-	for (int i=0; i<genos.genotype_num(); ++i) {
-		m_haplotypes[2*i] = genos[i](0);
-		m_haplotypes[2*i+1] = genos[i](1);
+	m_allele_index = genos.m_allele_index;
+	m_alleles = AlleleMatrix(0, m_haplotype_len, max_allele_num());
+	m_weights.clear();
+	m_allele_bits.assign(m_haplotype_len, vector<vector<unsigned int> >());
+	m_missing_bits.assign(m_haplotype_len, vector<unsigned int>());
+	for (int k=0; k<m_haplotype_len; ++k) {
+		m_allele_bits[k].resize(allele_num(k));
 	}
-	return *this;
+	m_total_weight = 0;
 }
 
+Haplotype HaploData::operator [](int i) const
+{
+	Haplotype h(m_haplotype_len);
+	for (int k=0; k<m_haplotype_len; ++k) {
+		h[k] = allele(i, k);
+	}
+	h.setWeight(m_weights[i]);
+	return h;
+}
 
-
-int HaploData::getAlleleIndex(int locus, Allele a) const
+double HaploData::getWeight(const vector<unsigned int> &bits) const
 {
-	int i;
-	bool found;
-	found = false;
-	for (i=0; i<allele_num(locus); ++i) {
-		if (a == allele_symbol(locus, i)) {
-			found = true;
-			break;
+	int i, j, n;
+	unsigned int w;
+	double weight = 0;
+	n = bits.size();
+	for (i=0; i<n; ++i) {
+		for (w=bits[i], j=i<<5; w; w>>=1, ++j) {
+			while (!(w & 0xFF)) {						// skip unmatched bytes
+				w >>= 8;
+				j += 8;
+			}
+			if (w & 1) weight += m_weights[j];
 		}
 	}
-	if (found) {
-		return i;
-	}
-	else {
-		return -1;
-	}
+	return weight;
 }
 
 void HaploData::setHaplotypeNum(int num)
 {
-	int i;
 	if (m_haplotype_num != num) {
+		int old_num = m_haplotype_num;
+		int old_words = word_num();
 		m_haplotype_num = num > 0 ? num : 0;
-		m_haplotypes.resize(m_haplotype_num);
-		for (i=0; i<m_haplotype_num; ++i) {
-			m_haplotypes[i].setLength(m_haplotype_len);
+		m_alleles.resize(m_haplotype_num);
+		m_weights.resize(m_haplotype_num, 1.0);
+		if (m_haplotype_num < old_num || word_num() != old_words) {
+			resizeBits();
+		}
+		for (int i=old_num; i<m_haplotype_num; ++i) {		// new haplotypes are all missing
+			for (int k=0; k<m_haplotype_len; ++k) {
+				m_missing_bits[k][i>>5] |= 1u << (i&31);
+			}
 		}
 	}
 }
 
+// fit the bitsets to the haplotype number and length, bits past the
+// last haplotype are kept clear
+void HaploData::resizeBits()
+{
+	int j, k, n;
+	unsigned int tail = (m_haplotype_num & 31) ? (1u << (m_haplotype_num & 31)) - 1 : ~0u;
+	n = word_num();
+	m_allele_bits.resize(m_haplotype_len);
+	m_missing_bits.resize(m_haplotype_len);
+	for (k=0; k<m_haplotype_len; ++k) {
+		m_allele_bits[k].resize(allele_num(k));
+		for (j=0; j<m_allele_bits[k].size(); ++j) {
+			m_allele_bits[k][j].resize(n, 0);
+			if (n > 0) m_allele_bits[k][j][n-1] &= tail;
+		}
+		m_missing_bits[k].resize(n, 0);
+		if (n > 0) m_missing_bits[k][n-1] &= tail;
+	}
+}
+
 void HaploData::setHaplotypeLen(int len)
 {
-	int i;
+	int i, k, old_len;
 	if (m_haplotype_len != len) {
+		old_len = m_haplotype_len;
 		m_haplotype_len = len > 0 ? len : 0;
-		for (i=0; i<m_haplotype_num; ++i) {
-			m_haplotypes[i].setLength(m_haplotype_len);
-		}
+		m_alleles.resize(m_haplotype_num, m_haplotype_len, m_alleles.missing());
 		m_allele_type.resize(m_haplotype_len);
 		m_allele_postition.resize(m_haplotype_len);
 		m_allele_name.resize(m_haplotype_len);
 		m_allele_symbol.resize(m_haplotype_len);
+		m_allele_index.resize(m_haplotype_len);
 		for (i=0; i<m_haplotype_len; ++i) {
 			m_allele_type[i] = 'M';
 			m_allele_postition[i] = i*Constant::average_marker_distance();
 		}
+		resizeBits();
+		for (k=old_len; k<m_haplotype_len; ++k) {			// new loci are all missing
+			for (i=0; i<m_haplotype_num; ++i) {
+				m_missing_bits[k][i>>5] |= 1u << (i&31);
+			}
+		}
+	}
+}
+
+void HaploData::setHaplotype(int i, const Haplotype &haplo)
+{
+	int k, n;
+	n = haplo.length() < m_haplotype_len ? haplo.length() : m_haplotype_len;
+	for (k=0; k<n; ++k) {
+		setAllele(i, k, haplo[k]);
+	}
+	for (; k<m_haplotype_len; ++k) {
+		m_alleles.set(i, k, -1);
+	}
+	m_weights[i] = haplo.weight();
+}
+
+void HaploData::setAllele(int i, int locus, const Allele &a)
+{
+	int index = -1;
+	unsigned int bit = 1u << (i&31);
+	if (!a.isMissing()) {
+		index = getAlleleIndex(locus, a);
+		if (index < 0) {										// new allele symbol
+			m_allele_index[locus].set(a, allele_num(locus));
+			m_allele_symbol[locus].push_back(make_pair(a, 0));
+			m_allele_bits[locus].push_back(vector<unsigned int>(word_num(), 0));
+			index = allele_num(locus) - 1;
+			if (index >= m_alleles.missing()) {
+				m_alleles.resize(m_alleles.rows(), m_alleles.cols(), index+1);
+			}
+		}
+	}
+	int old_index = m_alleles(i, locus);
+	if (old_index == m_alleles.missing()) {
+		m_missing_bits[locus][i>>5] &= ~bit;
+	}
+	else {
+		m_allele_bits[locus][old_index][i>>5] &= ~bit;
 	}
+	if (index < 0) {
+		m_missing_bits[locus][i>>5] |= bit;
+	}
+	else {
+		m_allele_bits[locus][index][i>>5] |= bit;
+	}
+	m_alleles.set(i, locus, index);
 }
 
 void HaploData::addHaplotype(const Haplotype &haplo)
 {
-	m_haplotypes.push_back(haplo);
-	m_haplotype_num++;
+	setHaplotypeNum(m_haplotype_num+1);
+	setHaplotype(m_haplotype_num-1, haplo);
 }
 
 void HaploData::addHaplotype(const vector<Haplotype> &haplos)
 {
-	m_haplotypes.insert(m_haplotypes.end(), haplos.begin(), haplos.end());
-	m_haplotype_num += haplos.size();
+	for (int i=0; i<haplos.size(); ++i) {
+		addHaplotype(haplos[i]);
+	}
 }
 
 void HaploData::checkTotalWeight()
 {
 	m_total_weight = 0;
 	for (int i=0; i<m_haplotype_num; ++i) {
-		m_total_weight += m_haplotypes[i].weight();
+		m_total_weight += m_weights[i];
 	}
 }
 
+// the symbols themselves are fixed by the packed codes, only their
+// frequencies are recounted
 void HaploData::checkAlleleSymbol()
 {
-	int i, j, k, l;
-	for (i=0; i<m_haplotype_len; ++i) {
-		m_allele_symbol[i].clear();
-	}
-	for (i=0; i<m_haplotype_num; ++i) {
-		const Haplotype &h = m_haplotypes[i];
-		for (k=0; k<m_haplotype_len; ++k) {
-			if (!h[k].isMissing()) {
-				if (getAlleleIndex(k, h[k]) < 0) {			// not found
-					m_allele_symbol[k].push_back(make_pair(h[k], 0));
-				}
-			}
-		}
-	}
-	for (i=0; i<m_haplotype_len; ++i) {
-		sort(m_allele_symbol[i].begin(), m_allele_symbol[i].end());
-	}
+	int i, j, k, c;
 	vector<double> total_weight;
 	total_weight.resize(m_haplotype_len, 0);
+	for (k=0; k<m_haplotype_len; ++k) {
+		for (j=0; j<allele_num(k); ++j) {
+			m_allele_symbol[k][j].second = 0;
+		}
+	}
 	for (i=0; i<m_haplotype_num; ++i) {
-		const Haplotype &h = m_haplotypes[i];
 		for (k=0; k<m_haplotype_len; ++k) {
-			if (!h[k].isMissing()) {
-				l = getAlleleIndex(k, h[k]);
-				m_allele_symbol[k][l].second += h.weight();
-				total_weight[k] += h.weight();
+			c = m_alleles(i, k);
+			if (c != m_alleles.missing()) {
+				m_allele_symbol[k][c].second += m_weights[i];
+				total_weight[k] += m_weights[i];
 			}
 		}
 	}
-	for (i=0; i<m_haplotype_len; ++i) {
-		for (j=0; j<allele_num(i); ++j) {
-			m_allele_symbol[i][j].second /= total_weight[i];
+	for (k=0; k<m_haplotype_len; ++k) {
+		for (j=0; j<allele_num(k); ++j) {
+			m_allele_symbol[k][j].second /= total_weight[k];
 		}
 	}
 }
 
 void HaploData::simplify()
 {
-	int i, k;
-	for (i=0; i<m_haplotype_num; ++i) {
-		Haplotype &h = m_haplotypes[i];
-		for (k=0; k<m_haplotype_len; ++k) {
-			if (!h[k].isMissing()) {
-				if (m_allele_type[k] == 'S') {
-					h[k] = getAlleleIndex(k, h[k]) + '1';
-				}
-				else {
-					h[k] = getAlleleIndex(k, h[k]) + 1;
-				}
+	int j, k;
+	for (k=0; k<m_haplotype_len; ++k) {
+		m_allele_index[k].clear();
+		for (j=0; j<allele_num(k); ++j) {
+			if (m_allele_type[k] == 'S') {
+				m_allele_symbol[k][j].first = j + '1';
+			}
+			else {
+				m_allele_symbol[k][j].first = j + 1;
 			}
+			m_allele_index[k].set(m_allele_symbol[k][j].first, j);
 		}
 	}
 }
@@ -8,13 +8,23 @@
 #include "Utils.h"
 #include "Constant.h"
 #include "Allele.h"
+#include "AlleleMatrix.h"
 #include "Haplotype.h"
 #include "GenoData.h"
 
 
+// Haplotypes are kept as allele indices in a packed AlleleMatrix, so
+// alleles must be found in (or are added to) the allele symbol lists.
+// For every locus and allele a bitset over the haplotypes is kept as
+// well, so a set of matching haplotypes can be narrowed one allele at a
+// time by word-wide ANDs.
+
 class HaploData {
 protected:
-	vector<Haplotype> m_haplotypes;
+	AlleleMatrix m_alleles;
+	vector<double> m_weights;
+	vector<vector<vector<unsigned int> > > m_allele_bits;	// [locus][allele] bitset of haplotypes
+	vector<vector<unsigned int> > m_missing_bits;			// [locus] bitset of haplotypes missing it
 	int m_haplotype_num;
 	int m_haplotype_len;
 	double m_total_weight;
@@ -23,6 +33,7 @@ protected:
 	vector<int> m_allele_postition;
 	vector<string> m_allele_name;
 	vector<vector<pair<Allele, double> > > m_allele_symbol;
+	vector<AlleleIndex> m_allele_index;
 
 public:
 	HaploData();
@@ -30,8 +41,9 @@ public:
 	explicit HaploData(const GenoData &genos);
 	HaploData &operator =(const GenoData &genos);
 
-	Haplotype &operator [](int i) { return m_haplotypes[i]; }
-	const Haplotype &operator [](int i) const { return m_haplotypes[i]; }
+	Haplotype operator [](int i) const;
+	Allele allele(int i, int locus) const;
+	double weight(int i) const { return m_weights[i]; }
 	int haplotype_num() const { return m_haplotype_num; }
 	int haplotype_len() const { return m_haplotype_len; }
 	double total_weight() const { return m_total_weight; }
@@ -46,10 +58,17 @@ public:
 	double allele_frequency(int locus, int index) const { return m_allele_symbol[locus][index].second; }
 	double allele_frequency(int locus, Allele a) const { return allele_frequency(locus, getAlleleIndex(locus, a)); }
 
-	int getAlleleIndex(int locus, Allele a) const;
+	int getAlleleIndex(int locus, Allele a) const { return m_allele_index[locus].find(a); }
+
+	int word_num() const { return (m_haplotype_num + 31) >> 5; }
+	void matchAll(vector<unsigned int> &bits) const;
+	void match(vector<unsigned int> &bits, int locus, const Allele &a) const;
+	double getWeight(const vector<unsigned int> &bits) const;
 
 	void setHaplotypeNum(int i);
 	void setHaplotypeLen(int i);
+	void setHaplotype(int i, const Haplotype &haplo);
+	void setWeight(int i, double weight) { m_weights[i] = weight; }
 	void setAlleleType(int locus, char type) { m_allele_type[locus] = type; }
 	void setAllelePosition(int locus, int position) { m_allele_postition[locus] = position; }
 	void setAlleleName(int locus, const string &name) { m_allele_name[locus] = name; string_replace(m_allele_name[locus], " ", "_"); }
@@ -57,13 +76,48 @@ public:
 	void addHaplotype(const Haplotype &haplo);
 	void addHaplotype(const vector<Haplotype> &haplos);
 
+	void reset(const GenoData &genos);
+
 	void checkTotalWeight();
 	void checkAlleleSymbol();
 	void simplify();
 
 	void clear() { setHaplotypeNum(0); }
 	bool empty() const { return (m_haplotype_num == 0); }
+
+protected:
+	void setAllele(int i, int locus, const Allele &a);
+	void resizeBits();
 };
 
+inline Allele HaploData::allele(int i, int locus) const
+{
+	int c = m_alleles(i, locus);
+	return c == m_alleles.missing() ? Allele() : allele_symbol(locus, c);
+}
+
+inline void HaploData::matchAll(vector<unsigned int> &bits) const
+{
+	bits.assign(word_num(), ~0u);
+	if (m_haplotype_num & 31) bits.back() = (1u << (m_haplotype_num & 31)) - 1;
+}
+
+// keep the haplotypes of bits whose allele at locus matches a
+inline void HaploData::match(vector<unsigned int> &bits, int locus, const Allele &a) const
+{
+	int i, n, index;
+	if (a.isMissing()) return;
+	const unsigned int *missing = &m_missing_bits[locus][0];
+	n = bits.size();
+	index = getAlleleIndex(locus, a);
+	if (index < 0) {
+		for (i=0; i<n; ++i) bits[i] &= missing[i];
+	}
+	else {
+		const unsigned int *allele = &m_allele_bits[locus][index][0];
+		for (i=0; i<n; ++i) bits[i] &= allele[i] | missing[i];
+	}
+}
+
 
 #endif // __HAPLODATA_H
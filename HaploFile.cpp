@@ -1,6 +1,7 @@
 
 #include <vector>
 #include <set>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "HaploFile.h"
 
@@ -10,6 +11,78 @@
 #define BUFFER_LENGTH 409600
 
 
+////////////////////////////////
+//
+// class TextReader
+
+// Reads a file line by line from a read-only memory mapping.  Each line
+// is copied into a buffer that grows as needed, so lines may be of any
+// length.
+
+class TextReader {
+	boost::iostreams::mapped_file_source m_file;
+	const char *m_pos, *m_end;
+	vector<char> m_line;
+
+public:
+	explicit TextReader(const string &filename);
+
+	char *getLine(bool skip_blank = false);
+	int countLines() const;
+};
+
+TextReader::TextReader(const string &filename)
+: m_pos(0),
+  m_end(0)
+{
+	FILE *fp = fopen(filename.c_str(), "r");
+	if (fp == NULL) {
+		Logger::error("Can not open file %s!", filename.c_str());
+		exit(1);
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fclose(fp);
+	if (size > 0) {								// empty files can not be mapped
+		try {
+			m_file.open(filename);
+		}
+		catch (std::exception &) {
+			Logger::error("Can not map file %s!", filename.c_str());
+			exit(1);
+		}
+		m_pos = m_file.data();
+		m_end = m_pos + m_file.size();
+	}
+}
+
+// next line including its newline, NULL at the end of file
+char *TextReader::getLine(bool skip_blank)
+{
+	while (m_pos < m_end) {
+		const char *p = (const char *) memchr(m_pos, '\n', m_end - m_pos);
+		const char *next = p ? p + 1 : m_end;
+		const char *s = m_pos;
+		m_pos = next;
+		if (skip_blank) {
+			while (s < next && strchr(" \t\r\n", *s)) ++s;
+			if (s == next) continue;
+		}
+		m_line.assign(s, next);
+		m_line.push_back(0);
+		return &m_line[0];
+	}
+	return NULL;
+}
+
+int TextReader::countLines() const
+{
+	int n = count(m_pos, m_end, '\n');
+	if (m_pos < m_end && m_end[-1] != '\n') ++n;
+	return n;
+}
+
+
 int HaploFile::getFileNameNum(const string &format)
 {
 	int num = 0;
@@ -53,68 +126,86 @@ HaploFile *HaploFile::getHaploFile(const string &format, vector<string>::const_i
 
 void HaploFile::readGenoData(GenoData &genos)
 {
-	FILE *fp;
-	char line[BUFFER_LENGTH], buf[BUFFER_LENGTH];
-	char *s, *delim = " \t\r\n";
+	TextReader in(m_filename);
+	char *line, *s, *delim = " \t\r\n";
 	Haplotype h1, h2;
 	int i, j;
-	fp = fopen(m_filename.c_str(), "r");
-	if (fp == NULL) {
-		Logger::error("Can not open file %s!", m_filename.c_str());
-		exit(1);
-	}
-	fscanf(fp, "%d\n", &i);
-	fscanf(fp, "%d\n", &j);
+	genos = GenoData();
+	m_genos = &genos;
+	line = in.getLine(true);
+	i = line ? atoi(line) : 0;
+	line = in.getLine(true);
+	j = line ? atoi(line) : 0;
 	if (i <= 0 || j <= 0) {
 		Logger::error("Invalid file type!");
 		exit(1);
 	}
-	m_genos.setGenotypeNum(i);
-	m_genos.setGenotypeLen(j);
+	m_genos->setGenotypeNum(i);
+	m_genos->setGenotypeLen(j);
 	// set loci positions
-	fgets(line, BUFFER_LENGTH, fp);
+	line = in.getLine(true);
+	if (line == NULL) {
+		Logger::error("Invalid file type!");
+		exit(1);
+	}
 	s = line + strspn(line, delim);
 	if (s[0] == 'P') {
 		s += strcspn(s, delim);
 		s += strspn(s, delim);
-		for (i=0; i<m_genos.genotype_len(); i++) {
-			m_genos.setAllelePosition(i, atoi(s));
+		for (i=0; i<m_genos->genotype_len(); i++) {
+			m_genos->setAllelePosition(i, atoi(s));
 			s += strcspn(s, delim);
 			s += strspn(s, delim);
 		}
-		fgets(line, BUFFER_LENGTH, fp);
+		line = in.getLine();
+		if (line == NULL) {
+			Logger::error("Invalid file type!");
+			exit(1);
+		}
 		s = line + strspn(line, delim);
 	}
 	// set loci type
-	for (i=0; i<m_genos.genotype_len(); i++) {
-		m_genos.setAlleleType(i, s[0]);
-		m_genos.setAlleleName(i, "M" + int2str(i+1));
-		s++;
+	for (i=0; i<m_genos->genotype_len(); i++) {
+		m_genos->setAlleleType(i, s[0]);
+		m_genos->setAlleleName(i, "M" + int2str(i+1));
+		if (s[0] != 0) s++;
 		s += strspn(s, delim);
 	}
-	for (i=0; i<m_genos.genotype_num(); i++) {
+	for (i=0; i<m_genos->genotype_num(); i++) {
 		if (m_has_id) {
-			fgets(line, BUFFER_LENGTH, fp);
-			if (sscanf(line, "%s", buf) > 0) {
-				m_genos[i].setID(buf);
+			line = in.getLine();
+			if (line == NULL) {
+				Logger::error("Incorrect haplotype data for individual %d!", i);
+				exit(1);
+			}
+			s = line + strspn(line, delim);
+			s[strcspn(s, delim)] = 0;					// tokenize the id in place
+			if (s[0] != 0) {
+				(*m_genos)[i].setID(s);
 			}
 		}
 		else {
-			m_genos[i].setID(int2str(i+1));
+			(*m_genos)[i].setID(int2str(i+1));
+		}
+		line = in.getLine();
+		if (line == NULL) {
+			Logger::error("Incorrect haplotype data for individual %d!", i);
+			exit(1);
 		}
-		fgets(line, BUFFER_LENGTH, fp);
-		h1.read(m_genos.allele_type().c_str(), line, m_genos.genotype_len());
-		fgets(line, BUFFER_LENGTH, fp);
-		h2.read(m_genos.allele_type().c_str(), line, m_genos.genotype_len());
-		if (h1.length() != m_genos.genotype_len() || h2.length() != m_genos.genotype_len()) {
+		h1.read(m_genos->allele_type().c_str(), line, m_genos->genotype_len());
+		line = in.getLine();
+		if (line == NULL) {
 			Logger::error("Incorrect haplotype data for individual %d!", i);
 			exit(1);
 		}
-		m_genos[i].setHaplotypes(h1, h2);
+		h2.read(m_genos->allele_type().c_str(), line, m_genos->genotype_len());
+		if (h1.length() != m_genos->genotype_len() || h2.length() != m_genos->genotype_len()) {
+			Logger::error("Incorrect haplotype data for individual %d!", i);
+			exit(1);
+		}
+		(*m_genos)[i].setHaplotypes(h1, h2);
 	}
-	fclose(fp);
-	m_genos.checkAlleleSymbol();
-	genos = m_genos;
+	m_genos->checkAlleleSymbol();
 }
 
 void HaploFile::writeGenoData(GenoData &genos, const char *suffix)
@@ -122,31 +213,31 @@ void HaploFile::writeGenoData(GenoData &genos, const char *suffix)
 	FILE *fp;
 	char buf[BUFFER_LENGTH], id;
 	int i, j;
-	m_genos = genos;
+	m_genos = &genos;
 	string output_file = m_filename + suffix;
 	fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
 		Logger::error("Can not open file %s!", m_filename.c_str());
 		exit(1);
 	}
-	fprintf(fp, "%d\n", m_genos.genotype_num());
-	fprintf(fp, "%d\n", m_genos.genotype_len());
+	fprintf(fp, "%d\n", m_genos->genotype_num());
+	fprintf(fp, "%d\n", m_genos->genotype_len());
 	fprintf(fp, "P");
-	for (i=0; i<m_genos.genotype_len(); i++) {
-		fprintf(fp, " %d", m_genos.allele_postition(i));
+	for (i=0; i<m_genos->genotype_len(); i++) {
+		fprintf(fp, " %d", m_genos->allele_postition(i));
 	}
 	fprintf(fp, "\n");
-	fprintf(fp, "%s\n", m_genos.allele_type().c_str());
-	for (i=0; i<m_genos.genotype_num(); i++) {
-		id = m_genos[i].id()[0];
+	fprintf(fp, "%s\n", m_genos->allele_type().c_str());
+	for (i=0; i<m_genos->genotype_num(); i++) {
+		id = (*m_genos)[i].id()[0];
 		if (id >= '0' && id <= '9') {
-			fprintf(fp, "#%s\n", m_genos[i].id().c_str());
+			fprintf(fp, "#%s\n", (*m_genos)[i].id().c_str());
 		}
 		else {
-			fprintf(fp, "%s\n", m_genos[i].id().c_str());
+			fprintf(fp, "%s\n", (*m_genos)[i].id().c_str());
 		}
 		for (j=0; j<2; j++) {
-			fprintf(fp, "%s\n", m_genos[i](j).write(m_genos.allele_type().c_str(), buf));
+			fprintf(fp, "%s\n", (*m_genos)[i](j).write(m_genos->allele_type().c_str(), buf));
 		}
 	}
 	fclose(fp);
@@ -155,7 +246,7 @@ void HaploFile::writeGenoData(GenoData &genos, const char *suffix)
 void HaploFile::writePattern(HaploBuilder &hb, const char *suffix)
 {
 	char buf[BUFFER_LENGTH];
-	m_genos = *hb.genos();
+	m_genos = hb.genos();
 	string output_file = m_filename + suffix;
 	FILE *fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
@@ -165,7 +256,32 @@ void HaploFile::writePattern(HaploBuilder &hb, const char *suffix)
 	fprintf(fp, "Frequency\tLength\t%s\n", writeAlleleName(buf));
 	for (int i=0; i<hb.pattern_num(); ++i) {
 		const HaploPattern *hp = hb.patterns(i);
-		fprintf(fp, "%f\t%d\t%s\n", hp->frequency() / m_genos.genotype_num(), hp->length(), hp->write(buf, true));
+		fprintf(fp, "%f\t%d\t%s\n", hp->frequency() / m_genos->genotype_num(), hp->length(), hp->write(buf, true));
+	}
+	fclose(fp);
+}
+
+// one line per heterozygous locus after the first of each genotype, with the
+// posterior probability of a phase switch, and per locus with a missing
+// allele, with the posterior probability of the imputed alleles
+void HaploFile::writeConfidence(GenoData &genos, const vector<vector<double> > &confidence, const char *suffix)
+{
+	int i, j;
+	m_genos = &genos;
+	string output_file = m_filename + suffix;
+	FILE *fp = fopen(output_file.c_str(), "w");
+	if (fp == NULL) {
+		Logger::error("Can not open file %s!", output_file.c_str());
+		exit(1);
+	}
+	fprintf(fp, "Id\tMarker\tPosition\tType\tProbability\n");
+	for (i=0; i<confidence.size(); ++i) {
+		const Genotype &g = genos[i];
+		for (j=0; j<confidence[i].size(); ++j) {
+			if (confidence[i][j] < 0) continue;
+			fprintf(fp, "%s\t%s\t%d\t%s\t%f\n", g.id().c_str(), genos.allele_name(j).c_str(), genos.allele_postition(j),
+				g.hasMissing(j) ? "MISSING" : "SWITCH", confidence[i][j]);
+		}
 	}
 	fclose(fp);
 }
@@ -178,8 +294,8 @@ char *HaploFile::readAlleleName(char *buffer)
 	strcpy(buf, buffer);
 	s = strtok(buf, delim);
 	i = 0;
-	while (s != NULL && i < m_genos.genotype_len()) {
-		m_genos.setAlleleName(i, s);
+	while (s != NULL && i < m_genos->genotype_len()) {
+		m_genos->setAlleleName(i, s);
 		s = strtok(NULL, delim);
 	}
 	delete[] buf;
@@ -190,8 +306,8 @@ char *HaploFile::writeAlleleName(char *buffer)
 {
 	int i;
 	buffer[0] = 0;
-	for (i=0; i<m_genos.genotype_len(); i++) {
-		strcat(buffer, m_genos.allele_name(i).c_str());
+	for (i=0; i<m_genos->genotype_len(); i++) {
+		strcat(buffer, m_genos->allele_name(i).c_str());
 		strcat(buffer, " ");
 	}
 	return buffer;
@@ -204,50 +320,49 @@ char *HaploFile::writeAlleleName(char *buffer)
 
 void HaploFileHPM::readGenoData(GenoData &genos)
 {
-	FILE *fp;
-	char line[BUFFER_LENGTH];
-	vector<Haplotype*> haplos;
-	Haplotype *h;
+	TextReader in(m_filename);
+	char *line;
+	Haplotype h1, h2;
 	int i, j;
-	fp = fopen(m_filename.c_str(), "r");
-	if (fp == NULL) {
-		Logger::error("Can not open file %s!", m_filename.c_str());
+	genos = GenoData();
+	m_genos = &genos;
+	line = in.getLine();
+	if (line == NULL) {
+		Logger::error("Not a valid HPM file!");
 		exit(1);
 	}
-	fgets(line, BUFFER_LENGTH, fp);
 	checkHeader(line);
-	while(fgets(line, BUFFER_LENGTH, fp) != NULL) {
-		h = new Haplotype;
-		readHaplotype(*h, line);
-		if (h->length() != m_genos.genotype_len()) {
-			Logger::error("Incorrect haplotype data in line %d!", haplos.size()+2);
-			exit(1);
-		}
-		haplos.push_back(h);
-	}
-	fclose(fp);
-	if (haplos.size() % 2 != 0) {
-		Logger::error("Incorrect haplotype data in line %d!", haplos.size()+2);
+	j = in.countLines();
+	if (j % 2 != 0) {
+		Logger::error("Incorrect haplotype data in line %d!", j+1);
 		exit(1);
 	}
-	m_genos.setGenotypeNum(haplos.size()/2);
-	for (i=0; i<m_genos.genotype_num(); ++i) {
-		m_genos[i].setID(haplos[2*i]->id());
-		m_genos[i].setHaplotypes(*haplos[2*i], *haplos[2*i+1]);
-	}
-	DeleteAll_Clear()(haplos);
-	m_genos.checkAlleleSymbol();
-	for (i=0; i<m_genos.genotype_len(); ++i) {
-		if (m_genos.allele_num(i) <= 2) {
-			m_genos.setAlleleType(i, 'S');
-			for (j=0; j<m_genos.genotype_num(); ++j) {
-				alleleTypeM2S(m_genos[j](0)[i]);
-				alleleTypeM2S(m_genos[j](1)[i]);
+	m_genos->setGenotypeNum(j/2);
+	for (i=0; i<m_genos->genotype_num(); ++i) {
+		readHaplotype(h1, in.getLine());
+		if (h1.length() != m_genos->genotype_len()) {
+			Logger::error("Incorrect haplotype data in line %d!", 2*i+2);
+			exit(1);
+		}
+		readHaplotype(h2, in.getLine());
+		if (h2.length() != m_genos->genotype_len()) {
+			Logger::error("Incorrect haplotype data in line %d!", 2*i+3);
+			exit(1);
+		}
+		(*m_genos)[i].setID(h1.id());
+		(*m_genos)[i].setHaplotypes(h1, h2);
+	}
+	m_genos->checkAlleleSymbol();
+	for (i=0; i<m_genos->genotype_len(); ++i) {
+		if (m_genos->allele_num(i) <= 2) {
+			m_genos->setAlleleType(i, 'S');
+			for (j=0; j<m_genos->genotype_num(); ++j) {
+				alleleTypeM2S((*m_genos)[j](0)[i]);
+				alleleTypeM2S((*m_genos)[j](1)[i]);
 			}
 		}
 	}
-	m_genos.checkAlleleSymbol();
-	genos = m_genos;
+	m_genos->checkAlleleSymbol();
 }
 
 void HaploFileHPM::alleleTypeM2S(Allele &a)
@@ -268,7 +383,7 @@ void HaploFileHPM::writeGenoData(GenoData &genos, const char *suffix)
 	FILE *fp;
 	char buf[BUFFER_LENGTH];
 	int i, j;
-	m_genos = genos;
+	m_genos = &genos;
 	string output_file = m_filename + suffix;
 	fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
@@ -277,9 +392,9 @@ void HaploFileHPM::writeGenoData(GenoData &genos, const char *suffix)
 	}
 	fprintf(fp, "Id\t%s", writeAlleleName(buf));
 	fprintf(fp, "\n");
-	for (i=0; i<m_genos.genotype_num(); i++) {
+	for (i=0; i<m_genos->genotype_num(); i++) {
 		for (j=0; j<2; j++) {
-			fprintf(fp, "%s\n", writeHaplotype(m_genos[i](j), buf));
+			fprintf(fp, "%s\n", writeHaplotype((*m_genos)[i](j), buf));
 		}
 	}
 	fclose(fp);
@@ -290,7 +405,7 @@ void HaploFileHPM::writeGenoDataWithFreq(GenoData &genos, const char *suffix)
 	FILE *fp;
 	char buf[BUFFER_LENGTH];
 	int i, j;
-	m_genos = genos;
+	m_genos = &genos;
 	string output_file = m_filename + suffix;
 	fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
@@ -298,9 +413,9 @@ void HaploFileHPM::writeGenoDataWithFreq(GenoData &genos, const char *suffix)
 		exit(1);
 	}
 	fprintf(fp, "Id\t%s\tCONFIDENCE\n", writeAlleleName(buf));
-	for (i=0; i<m_genos.genotype_num(); i++) {
+	for (i=0; i<m_genos->genotype_num(); i++) {
 		for (j=0; j<2; j++) {
-			fprintf(fp, "%s\t%e\n", writeHaplotype(m_genos[i](j), buf), m_genos[i](j).weight());
+			fprintf(fp, "%s\t%e\n", writeHaplotype((*m_genos)[i](j), buf), (*m_genos)[i](j).weight());
 		}
 	}
 	fclose(fp);
@@ -308,7 +423,7 @@ void HaploFileHPM::writeGenoDataWithFreq(GenoData &genos, const char *suffix)
 
 char *HaploFileHPM::readHaplotype(Haplotype &h, char *buffer)
 {
-	string allele_type(m_genos.genotype_len(), 'M');
+	string allele_type(m_genos->genotype_len(), 'M');
 	int i;
 	char *s, *buf, *delim = " \t\r\n";
 	buf = new char [strlen(buffer)+100];
@@ -319,7 +434,7 @@ char *HaploFileHPM::readHaplotype(Haplotype &h, char *buffer)
 		s = strtok(NULL, delim);
 	}
 	s += strlen(s)+1;
-	s = h.read(allele_type.c_str(), s, m_genos.genotype_len());
+	s = h.read(allele_type.c_str(), s, m_genos->genotype_len());
 	if (m_weighted) {
 		s += strspn(s, delim);
 		h.setWeight(atof(s));
@@ -333,7 +448,7 @@ char *HaploFileHPM::readHaplotype(Haplotype &h, char *buffer)
 
 char *HaploFileHPM::writeHaplotype(const Haplotype &h, char *buffer)
 {
-	string allele_type = m_genos.allele_type();
+	string allele_type = m_genos->allele_type();
 	char *s = buffer;
 	strcpy(s, h.id().c_str());
 	strcat(s, "\t");
@@ -378,9 +493,9 @@ void HaploFileHPM::checkHeader(char *buffer)
 	else {
 		m_weighted = false;
 	}
-	m_genos.setGenotypeLen(len);
+	m_genos->setGenotypeLen(len);
 	for (i=0; i<len; i++) {
-		m_genos.setAlleleName(i, names[i]);
+		m_genos->setAlleleName(i, names[i]);
 	}
 	delete[] buf;
 }
@@ -388,7 +503,7 @@ void HaploFileHPM::checkHeader(char *buffer)
 
 char *HaploFileHPM2::readHaplotype(Haplotype &h, char *buffer)
 {
-	string allele_type(m_genos.genotype_len(), 'S');
+	string allele_type(m_genos->genotype_len(), 'S');
 	int i;
 	char *s, *buf, *delim = " \t\r\n";
 	buf = new char [strlen(buffer)+100];
@@ -399,7 +514,7 @@ char *HaploFileHPM2::readHaplotype(Haplotype &h, char *buffer)
 		s = strtok(NULL, delim);
 	}
 	s += strlen(s)+1;
-	s = h.read(allele_type.c_str(), s, m_genos.genotype_len());
+	s = h.read(allele_type.c_str(), s, m_genos->genotype_len());
 	if (m_weighted) {
 		s += strspn(s, delim);
 		h.setWeight(atof(s));
@@ -417,7 +532,7 @@ char *HaploFileHPM2::readHaplotype(Haplotype &h, char *buffer)
 
 char *HaploFileHPM2::writeHaplotype(const Haplotype &h, char *buffer)
 {
-	string allele_type = m_genos.allele_type();
+	string allele_type = m_genos->allele_type();
 	int i;
 	Haplotype hh = h;
 	for (i=0; i<hh.length(); ++i) {
@@ -445,42 +560,34 @@ char *HaploFileHPM2::writeHaplotype(const Haplotype &h, char *buffer)
 
 void HaploFileBench::readGenoData(GenoData &genos)
 {
-	FILE *fp;
-	char line[BUFFER_LENGTH];
-	char *s, *delim = " \t\r\n";
-	vector<Haplotype*> haplos;
+	char *line, *s, *delim = " \t\r\n";
 	int i;
-	fp = fopen(m_filename.c_str(), "r");
-	if (fp == NULL) {
-		Logger::error("Can not open file %s!", m_filename.c_str());
-		exit(1);
-	}
+	genos = GenoData();
+	m_genos = &genos;
+	TextReader parents(m_filename);
 	// get genotype length
-	fgets(line, BUFFER_LENGTH, fp);
-	s = line + strspn(line, delim);
-	m_genos.setGenotypeLen(strcspn(s, delim));
+	line = parents.getLine();
+	s = line ? line + strspn(line, delim) : (char *) "";
+	m_genos->setGenotypeLen(strcspn(s, delim));
 	// set loci type
-	for (i=0; i<m_genos.genotype_len(); i++) {
-		m_genos.setAlleleType(i, 'S');
-		m_genos.setAlleleName(i, "M" + int2str(i+1));
+	for (i=0; i<m_genos->genotype_len(); i++) {
+		m_genos->setAlleleType(i, 'S');
+		m_genos->setAlleleName(i, "M" + int2str(i+1));
 	}
-	fclose(fp);
-	readHaploFile(haplos, m_filename.c_str());
-	m_parents_num = haplos.size() / 2;
+	m_parents_num = TextReader(m_filename).countLines() / 2;
+	m_children_num = 0;
 	if (!m_children_file.empty()) {
-		readHaploFile(haplos, m_children_file.c_str());
-		m_children_num = haplos.size() / 2 - m_parents_num;
+		m_children_num = TextReader(m_children_file).countLines() / 2;
 	}
-	m_genos.setGenotypeNum(m_parents_num + m_children_num);
-	m_genos.setUnphasedNum(m_parents_num);
-	for (i=0; i<m_genos.genotype_num(); i++) {
-		m_genos[i].setID(haplos[2*i]->id());
-		m_genos[i].setHaplotypes(*haplos[2*i], *haplos[2*i+1]);
+	m_genos->setGenotypeNum(m_parents_num + m_children_num);
+	m_genos->setUnphasedNum(m_parents_num);
+	readHaploFile(m_filename.c_str(), 0);
+	if (!m_children_file.empty()) {
+		readHaploFile(m_children_file.c_str(), m_parents_num);
 	}
-	m_genos.checkAlleleSymbol();
+	m_genos->checkAlleleSymbol();
 	// get position info
 	readPositionInfo(m_posinfo_file.c_str());
-	genos = m_genos;
 }
 
 void HaploFileBench::writeGenoData(GenoData &genos, const char *suffix)
@@ -488,16 +595,16 @@ void HaploFileBench::writeGenoData(GenoData &genos, const char *suffix)
 	FILE *fp;
 	char buf[BUFFER_LENGTH];
 	int i, j;
-	m_genos = genos;
+	m_genos = &genos;
 	string output_file = m_filename + suffix;
 	fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
 		Logger::error("Can not open file %s!", m_filename.c_str());
 		exit(1);
 	}
-	for (i=0; i<m_genos.genotype_num(); i++) {
+	for (i=0; i<m_genos->genotype_num(); i++) {
 		for (j=0; j<2; j++) {
-			fprintf(fp, "%s   %d 0 %s\n", writeHaplotype(m_genos[i](j), buf), 2*i+j, m_genos[i](j).id().c_str());
+			fprintf(fp, "%s   %d 0 %s\n", writeHaplotype((*m_genos)[i](j), buf), 2*i+j, (*m_genos)[i](j).id().c_str());
 		}
 	}
 	fclose(fp);
@@ -509,82 +616,73 @@ void HaploFileBench::writeGenoDataWithFreq(GenoData &genos, const char *suffix)
 	FILE *fp;
 	char buf[BUFFER_LENGTH];
 	int i, j;
-	m_genos = genos;
+	m_genos = &genos;
 	string output_file = m_filename + suffix;
 	fp = fopen(output_file.c_str(), "w");
 	if (fp == NULL) {
 		Logger::error("Can not open file %s!", m_filename.c_str());
 		exit(1);
 	}
-	for (i=0; i<m_genos.genotype_num(); i++) {
+	for (i=0; i<m_genos->genotype_num(); i++) {
 		for (j=0; j<2; j++) {
-			fprintf(fp, "%s   %f\n", writeHaplotype(m_genos[i](j), buf), m_genos[i](j).weight());
+			fprintf(fp, "%s   %f\n", writeHaplotype((*m_genos)[i](j), buf), (*m_genos)[i](j).weight());
 		}
 	}
 	fclose(fp);
 	writePositionInfo(m_posinfo_file.c_str());
 }
 
-void HaploFileBench::readHaploFile(vector<Haplotype*> &haplos, const char *filename)
+// read the haplotype pairs of filename into genotypes from first on
+void HaploFileBench::readHaploFile(const char *filename, int first)
 {
-	FILE *fp;
-	char line[BUFFER_LENGTH];
-	char *s, *delim = " \t\r\n";
-	Haplotype *h;
-	int heterozygous;
-	fp = fopen(filename, "r");
-	if (fp == NULL) {
-		Logger::error("Can not open file %s!", filename);
+	TextReader in(filename);
+	char *line, *s, *delim = " \t\r\n";
+	Haplotype h[2];
+	int i, j, n;
+	n = in.countLines();
+	if (n % 2 != 0) {
+		Logger::error("Incorrect haplotype data in line %d!", n+1);
 		exit(1);
 	}
-	// read haplotypes
-	heterozygous = 1;
-	while(fgets(line, BUFFER_LENGTH, fp) != NULL) {
-		h = new Haplotype;
-		s = readHaplotype(*h, line, heterozygous);
+	for (i=0; i<n; ++i) {
+		line = in.getLine();
+		j = i % 2;
+		s = readHaplotype(h[j], line, j+1);
 		s += strspn(s, delim);		// next is number
 		s += strcspn(s, delim);		// skip
 		s += strspn(s, delim);		// next is 0
 		s += strcspn(s, delim);		// skip
 		s += strspn(s, delim);		// next is id
 		s[strcspn(s, "\r\n")] = 0;
-		h->setID(s);
-		if (h->length() != m_genos.genotype_len()) {
-			Logger::error("Incorrect haplotype data in line %d of %s!", haplos.size()+2, filename);
+		h[j].setID(s);
+		if (h[j].length() != m_genos->genotype_len()) {
+			Logger::error("Incorrect haplotype data in line %d of %s!", i+1, filename);
 			exit(1);
 		}
-		haplos.push_back(h);
-		heterozygous = 3 - heterozygous;
-	}
-	if (haplos.size() % 2 != 0) {
-		Logger::error("Incorrect haplotype data in line %d!", haplos.size()+2);
-		exit(1);
+		if (j == 1) {
+			Genotype &g = (*m_genos)[first+i/2];
+			g.setID(h[0].id());
+			g.setHaplotypes(h[0], h[1]);
+		}
 	}
-	fclose(fp);
 }
 
 void HaploFileBench::readPositionInfo(const char *filename)
 {
-	FILE *fp;
-	char line[BUFFER_LENGTH];
-	char *s, *delim = " \t\r\n";
+	TextReader in(filename);
+	char *line, *s, *delim = " \t\r\n";
 	int i;
-	fp = fopen(filename, "r");
-	if (fp == NULL) {
-		Logger::error("Can not open file %s!", filename);
-		exit(1);
-	}
-	while(fgets(line, BUFFER_LENGTH, fp) != NULL) {
+	while ((line = in.getLine()) != NULL) {
 		s = strtok(line, delim);
+		if (s == NULL) continue;
 		i = atoi(s);
-		if (i >= 0 && i < m_genos.genotype_len()) {
+		if (i >= 0 && i < m_genos->genotype_len()) {
 			s = strtok(NULL, delim);
-			m_genos.setAlleleName(i, s);
+			m_genos->setAlleleName(i, s);
 			s = strtok(NULL, delim);
-			m_genos.setAllelePosition(i, atoi(s));
+			m_genos->setAllelePosition(i, atoi(s));
 		}
 	}
-	fclose(fp);
 }
 
 void HaploFileBench::writePositionInfo(const char *filename)
@@ -596,8 +694,8 @@ void HaploFileBench::writePositionInfo(const char *filename)
 		Logger::error("Can not open file %s!", filename);
 		exit(1);
 	}
-	for (i=0; i<m_genos.genotype_len(); ++i) {
-		fprintf(fp, " %d   %s   %d\n", i, m_genos.allele_name(i).c_str(), m_genos.allele_postition(i));
+	for (i=0; i<m_genos->genotype_len(); ++i) {
+		fprintf(fp, " %d   %s   %d\n", i, m_genos->allele_name(i).c_str(), m_genos->allele_postition(i));
 	}
 	fclose(fp);
 }
@@ -606,7 +704,7 @@ char *HaploFileBench::readHaplotype(Haplotype &h, char *buffer, int heterozygous
 {
 	int i;
 	char *buf, *delim = " \t\r\n";
-	h.setLength(m_genos.genotype_len());
+	h.setLength(m_genos->genotype_len());
 	buf = buffer + strspn(buffer, delim);
 	for (i=0; i<h.length(); i++) {
 		if (buf[i] == '0') {
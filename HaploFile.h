@@ -14,7 +14,7 @@
 
 class HaploFile {
 protected:
-	GenoData m_genos;
+	GenoData *m_genos;
 	string m_filename;
 
 	bool m_has_id;
@@ -32,6 +32,7 @@ public:
 	virtual void writeGenoData(GenoData &genos, const char *suffix = "");
 
 	virtual void writePattern(HaploBuilder &genos, const char *suffix = "");
+	void writeConfidence(GenoData &genos, const vector<vector<double> > &confidence, const char *suffix = "");
 
 	static int getFileNameNum(const string &format);
 	static HaploFile *getHaploFile(const string &format, vector<string>::const_iterator fn);
@@ -42,13 +43,15 @@ protected:
 };
 
 inline HaploFile::HaploFile()
-: m_has_id(true)
+: m_genos(0),
+  m_has_id(true)
 {
 }
 
 inline HaploFile::HaploFile(const string &filename)
-: m_has_id(true),
-  m_filename(filename)
+: m_genos(0),
+  m_filename(filename),
+  m_has_id(true)
 {
 }
 
@@ -106,7 +109,7 @@ public:
 	virtual void writeGenoDataWithFreq(GenoData &genos, const char *suffix = NULL);
 
 protected:
-	void readHaploFile(vector<Haplotype*> &haplos, const char *filename);
+	void readHaploFile(const char *filename, int first);
 	void readPositionInfo(const char *filename);
 	void writePositionInfo(const char *filename);
 	char *readHaplotype(Haplotype &h, char *buffer, int heterozygous);
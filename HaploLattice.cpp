@@ -0,0 +1,648 @@
+#include "HaploLattice.h"
+#include "HaploBuilder.h"
+#include "GenoData.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#include "MemLeak.h"
+
+
+////////////////////////////////
+//
+// class HaploPairIndex
+
+HaploPairIndex::HaploPairIndex(int capacity)
+: m_generation(1),
+  m_size(0)
+{
+	int n = 1;
+	while (n < capacity) n <<= 1;
+	Entry e = { 0, 0, 0, -1 };
+	m_table.assign(n, e);
+}
+
+void HaploPairIndex::clear()
+{
+	if (++m_generation == 0) {						// stamps wrapped around
+		for (int i=0; i<m_table.size(); ++i) {
+			m_table[i].generation = 0;
+		}
+		m_generation = 1;
+	}
+	m_size = 0;
+}
+
+void HaploPairIndex::rehash(int capacity)
+{
+	vector<Entry> old_table(capacity);
+	unsigned int old_generation = m_generation;
+	old_table.swap(m_table);						// new table is all stamped 0
+	m_generation = 1;
+	for (int i=0; i<old_table.size(); ++i) {
+		if (old_table[i].generation == old_generation) {
+			Entry e = old_table[i];
+			e.generation = m_generation;
+			m_table[probe(e.id_a, e.id_b)] = e;
+		}
+	}
+}
+
+
+////////////////////////////////
+//
+// class HaploLattice
+
+HaploLattice::HaploLattice(const HaploBuilder &hb)
+: m_builder(hb),
+  m_random(rand()),
+  m_likelihood(0),
+  m_discarded(0),
+  m_scale(0),
+  m_sample_size(1)
+{
+}
+
+HaploLattice::~HaploLattice()
+{
+}
+
+void HaploLattice::initialize()
+{
+	m_layers.resize(m_builder.genotype_len()+1);
+	for (int i=0; i<m_layers.size(); ++i) {
+		m_layers[i].clear(m_sample_size);
+	}
+	m_best_pair.clear();
+	m_likelihood = 0;
+	m_discarded = 0;
+	m_scale = 0;
+}
+
+double HaploLattice::resolve(const Genotype &genotype, Genotype &resolution, vector<Genotype> &res_list, int sample_size)
+{
+	const GenoData *genos = m_builder.genos();
+	int geno_len = m_builder.genotype_len();
+	int head_len = m_builder.pattern_manager().head_len();
+	int i, j, k, n;
+	double total_likelihood, coverage;
+	vector<HaploPairLink> res_link;
+	m_sample_size = sample_size > 1 ? sample_size : 1;
+	initialize();
+	initHeadList(genotype);
+	prune(head_len);
+	m_layers[head_len].rescale();
+	for (i=head_len; i<geno_len; ++i) {
+		m_best_pair.clear();
+		if (genotype.isMissing(i)) {
+			for (j=0; j<genos->allele_num(i); ++j) {
+				if (genos->allele_frequency(i, j) > 0) {
+					for (k=j; k<genos->allele_num(i); ++k) {
+						if (genos->allele_frequency(i, k) > 0) {
+							extendAll(i, j, k);
+						}
+					}
+				}
+			}
+		}
+		else if (genotype(0)[i].isMissing()) {
+			k = genos->getAlleleIndex(i, genotype(1)[i]);
+			for (j=0; j<genos->allele_num(i); ++j) {
+				if (genos->allele_frequency(i, j) > 0) {
+					extendAll(i, j, k);
+				}
+			}
+		}
+		else if (genotype(1)[i].isMissing()) {
+			k = genos->getAlleleIndex(i, genotype(0)[i]);
+			for (j=0; j<genos->allele_num(i); ++j) {
+				if (genos->allele_frequency(i, j) > 0) {
+					extendAll(i, j, k);
+				}
+			}
+		}
+		else {
+			extendAll(i, genos->getAlleleIndex(i, genotype(0)[i]), genos->getAlleleIndex(i, genotype(1)[i]));
+		}
+		prune(i+1);
+		m_layers[i].setLinks(m_link_source, m_link_target, m_link_reversed);
+		m_link_source.clear();
+		m_link_target.clear();
+		m_link_reversed.clear();
+		m_layers[i+1].rescale();
+		if (m_layers[i+1].empty()) {
+			break;
+		}
+	}
+	const HaploLayer &last = m_layers[geno_len];
+	if (!last.empty()) {
+		for (i=head_len; i<=geno_len; ++i) {
+			m_scale += m_layers[i].scale;
+		}
+		total_likelihood = 0;
+		res_link.clear();
+		for (j=0; j<last.size(); ++j) {
+			total_likelihood += last.forward_likelihood[j];
+			k = res_link.size();
+			n = last.best_num[j];
+			res_link.insert(res_link.end(), last.best(j), last.best(j)+n);
+			for (i=k; i<k+n; ++i) {
+				res_link[i].link = j;
+				res_link[i].index = i-k;
+				if (!res_link[i].homozygous) res_link[i].likelihood *= 2.0;
+			}
+			if (res_link.size() > m_sample_size) {
+				nth_element(res_link.begin(), res_link.begin()+m_sample_size-1, res_link.end(), greater<HaploPairLink>());
+				res_link.resize(m_sample_size);
+			}
+		}
+		sort(res_link.begin(), res_link.end(), greater<HaploPairLink>());
+		m_likelihood = total_likelihood;
+		double log_likelihood = log(total_likelihood) + m_scale * log(2.0);
+		coverage = 0;
+		res_list.clear();
+		n = res_link.size();
+		for (i=0; i<n; ++i) {
+			res_list.push_back(getGenotype(geno_len, res_link[i].link, res_link[i].index));
+			res_list[i].setPosteriorProbability(res_list[i].prior_probability() / total_likelihood);
+			res_list[i].setPriorProbability(ldexp(res_list[i].prior_probability(), m_scale));
+			res_list[i].setLogGenotypeProbability(log_likelihood);
+			coverage += res_list[i].posterior_probability();
+		}
+		resolution = res_list.front();
+	}
+	else {
+		coverage = 0;
+		res_list.clear();
+		resolution = genotype;
+		resolution.setPriorProbability(0);
+		resolution.setPosteriorProbability(0);
+		resolution.setLogGenotypeProbability(-HUGE_VAL);
+	}
+	return coverage;
+}
+
+void HaploLattice::initHeadList(const Genotype &genotype)
+{
+	const GenoData *genos = m_builder.genos();
+	int head_len = m_builder.pattern_manager().head_len();
+	const vector<HaploPattern*> &head_list = m_builder.pattern_manager().head_list();
+	const BackwardPatternTree *pattern_tree = m_builder.pattern_manager().pattern_tree();
+	vector<AlleleSequence*> new_list, last_list;
+	vector<AlleleSequence*>::iterator i_as;
+	vector<HaploPattern*>::const_iterator head;
+	for (head = head_list.begin(); head != head_list.end(); ++head) {
+		if ((*head)->isMatch(genotype)) {
+			last_list.push_back(new AlleleSequence);
+			for (int j=0; j<head_len; ++j) {
+				i_as = last_list.begin();
+				if (genotype.isMissing(j) || (genotype.hasMissing(j) && genotype.hasAllele(j, (**head)[j]))) {
+					while (i_as != last_list.end()) {
+						AlleleSequence *as = *i_as;
+						for (int k=0; k<genos->allele_num(j); ++k) {
+							if (genos->allele_frequency(j, k) > 0) {
+								AlleleSequence *new_as = new AlleleSequence;
+								new_as->assign(*as, genos->allele_symbol(j, k));
+								new_list.push_back(new_as);
+							}
+						}
+						++i_as;
+					}
+				}
+				else if (genotype.isHeterozygous(j)) {
+					while (i_as != last_list.end()) {
+						AlleleSequence *as = *i_as;
+						AlleleSequence *new_as = new AlleleSequence;
+						if ((**head)[j] == genotype(0)[j]) {
+							new_as->assign(*as, genotype(1)[j]);
+						}
+						else {
+							new_as->assign(*as, genotype(0)[j]);
+						}
+						new_list.push_back(new_as);
+						++i_as;
+					}
+				}
+				else {
+					while (i_as != last_list.end()) {
+						AlleleSequence *as = *i_as;
+						AlleleSequence *new_as = new AlleleSequence;
+						new_as->assign(*as, genotype(0)[j]);
+						new_list.push_back(new_as);
+						++i_as;
+					}
+				}
+				DeleteAll_Clear()(last_list);
+				last_list.swap(new_list);
+			}
+			i_as = last_list.begin();
+			while (i_as != last_list.end()) {
+				HaploPattern *hp = pattern_tree->findLongestMatchPattern(head_len, *i_as);
+				if (hp && hp->start() == 0) {
+					if (hp->id() >= (*head)->id()) {
+						HaploLayer &hl = m_layers[head_len];
+						bool homo = (hp->id() == (*head)->id());
+						double p = (*head)->frequency() * hp->frequency();
+						int k = hl.add(*head, hp, p);
+						hl.forward_likelihood[k] = homo ? p : 2.0 * p;
+						hl.best(k)[0] = HaploPairLink(-1, 0, false, homo, p);
+						hl.best_num[k] = 1;
+					}
+				}
+				else {
+					Logger::error("Can not find matching pattern!");
+					exit(1);
+				}
+				++i_as;
+			}
+			DeleteAll_Clear()(last_list);
+		}
+	}
+}
+
+// a1 and a2 are allele indexes at locus i
+void HaploLattice::extendAll(int i, int a1, int a2)
+{
+	int j, n;
+	if (a1 < 0 || a2 < 0) return;
+	n = m_layers[i].size();
+	for (j=0; j<n; ++j) {
+		extend(i, j, a1, a2);
+		if (a1 != a2) extend(i, j, a2, a1);
+	}
+}
+
+void HaploLattice::extend(int i, int j, int a1, int a2)
+{
+	const HaploLayer &hl = m_layers[i];
+	if (hl.forward_likelihood[j] <= 0) return;
+	const PatternManager &pm = m_builder.pattern_manager();
+	const PatternSuccessor &psa = pm.successor(hl.pattern_a[j]->id(), a1);
+	const PatternSuccessor &psb = pm.successor(hl.pattern_b[j]->id(), a2);
+	if (psa.pattern >= 0 && psb.pattern >= 0) {
+		addHaploPair(i, j, psa, psb);
+	}
+}
+
+void HaploLattice::addHaploPair(int i, int j, const PatternSuccessor &psa, const PatternSuccessor &psb)
+{
+	int k, n, r;
+	bool reversed = psa.pattern > psb.pattern;
+	int ida = reversed ? psb.pattern : psa.pattern;
+	int idb = reversed ? psa.pattern : psb.pattern;
+	const HaploLayer &hl = m_layers[i];
+	HaploLayer &next = m_layers[i+1];
+	int &index = m_best_pair(ida, idb);
+	if (index < 0) {
+		const PatternManager &pm = m_builder.pattern_manager();
+		index = next.add(pm[ida], pm[idb], psa.transition_prob * psb.transition_prob);
+		next.best_num[index] = 0;
+	}
+	k = index;
+	double p = next.transition_prob[k];
+	next.forward_likelihood[k] += hl.forward_likelihood[j] * p;
+	m_link_buffer.clear();
+	m_zero_links.clear();
+	n = hl.best_num[j];
+	for (r=0; r<n && m_link_buffer.size()<next.best_size; ++r) {
+		HaploPairLink link = hl.best(j)[r];
+		link.likelihood *= p;
+		if (!next.acceptsLink(k, link.likelihood)) break;		// the rest are no more likely
+		link.link = j;
+		link.index = r;
+		link.reversed = reversed;
+		if (link.homozygous && next.allele_a[k] != next.allele_b[k]) {
+			link.homozygous = false;
+			if (reversed) {
+				link.likelihood = 0;
+				m_zero_links.push_back(link);					// kept after the others to stay in order
+				continue;
+			}
+		}
+		m_link_buffer.push_back(link);
+	}
+	m_link_buffer.insert(m_link_buffer.end(), m_zero_links.begin(), m_zero_links.end());
+	if (!m_link_buffer.empty()) {
+		next.mergeLinks(k, &m_link_buffer[0], m_link_buffer.size());
+	}
+	m_link_source.push_back(j);
+	m_link_target.push_back(k);
+	m_link_reversed.push_back(reversed);
+}
+
+// drop the pairs of layer i outside the beam, together with the links to them
+void HaploLattice::prune(int i)
+{
+	HaploLayer &hl = m_layers[i];
+	int beam_width = m_builder.beam_width;
+	double beam_ratio = m_builder.beam_ratio;
+	int j, k, n, ties;
+	n = hl.size();
+	if (n <= 0 || (beam_width <= 0 || n <= beam_width) && beam_ratio <= 0) return;
+	double total = 0, kept = 0, threshold = 0;
+	for (j=0; j<n; ++j) {
+		total += hl.forward_likelihood[j];
+		if (hl.forward_likelihood[j] > threshold) threshold = hl.forward_likelihood[j];
+	}
+	threshold *= beam_ratio > 0 ? beam_ratio : 0;
+	ties = n;
+	if (beam_width > 0 && n > beam_width) {
+		m_weight.assign(hl.forward_likelihood.begin(), hl.forward_likelihood.end());
+		nth_element(m_weight.begin(), m_weight.begin()+beam_width-1, m_weight.end(), greater<double>());
+		if (m_weight[beam_width-1] >= threshold) {
+			threshold = m_weight[beam_width-1];
+			ties = beam_width;
+			for (j=0; j<n; ++j) {
+				if (hl.forward_likelihood[j] > threshold) --ties;
+			}
+		}
+	}
+	m_index.resize(n);
+	for (j=0, k=0; j<n; ++j) {
+		double p = hl.forward_likelihood[j];
+		if (p > threshold || (p == threshold && ties-- > 0)) {
+			m_index[j] = 0;
+			kept += p;
+			++k;
+		}
+		else {
+			m_index[j] = -1;
+		}
+	}
+	if (k == n) return;
+	hl.compact(m_index);
+	if (total > 0) m_discarded += (1.0 - m_discarded) * (1.0 - kept / total);
+	n = m_link_target.size();
+	for (j=0, k=0; j<n; ++j) {
+		if (m_index[m_link_target[j]] >= 0) {
+			m_link_source[k] = m_link_source[j];
+			m_link_target[k] = m_index[m_link_target[j]];
+			m_link_reversed[k] = m_link_reversed[j];
+			++k;
+		}
+	}
+	m_link_source.resize(k);
+	m_link_target.resize(k);
+	m_link_reversed.resize(k);
+}
+
+Genotype HaploLattice::getGenotype(int i, int j, int index) const
+{
+	int a = 0, b = 1;
+	int locus = i - 1;
+	Genotype g(m_builder.genotype_len());
+	const HaploPairLink &best = m_layers[i].best(j)[index];
+	if (best.homozygous) {
+		g.setPriorProbability(best.likelihood);
+	}
+	else {
+		g.setPriorProbability(best.likelihood * 2.0);
+	}
+	while (true) {
+		const HaploLayer &hl = m_layers[i];
+		if (index < hl.best_num[j] && hl.best(j)[index].link >= 0) {
+			const HaploPairLink &link = hl.best(j)[index];
+			g(a)[locus] = hl.allele_a[j];
+			g(b)[locus] = hl.allele_b[j];
+			if (link.reversed) swap(a, b);
+			j = link.link;
+			index = link.index;
+			--i;
+			--locus;
+		}
+		else {
+			const HaploPattern &pa = *hl.pattern_a[j];
+			const HaploPattern &pb = *hl.pattern_b[j];
+			copy(&pa[0], &pa[0]+locus+1-pa.start(), &g(a)[pa.start()]);
+			copy(&pb[0], &pb[0]+locus+1-pb.start(), &g(b)[pb.start()]);
+			break;
+		}
+	}
+	g.checkGenotype();
+	return g;
+}
+
+// Draw n configurations of the last resolved genotype from its posterior.
+// A pair of the last layer is drawn in proportion to its forward
+// likelihood, then each predecessor link in proportion to the forward
+// likelihood of its source, as all links into a pair share its transition
+// probability.  Each sample gets the posterior probability 1/n, so repeated
+// configurations add up, and the lattice needs no more memory for larger n.
+double HaploLattice::drawSamples(int n, vector<Genotype> &samples)
+{
+	int geno_len = m_builder.genotype_len();
+	int head_len = m_builder.pattern_manager().head_len();
+	int i, j, k, l, s, locus;
+	samples.clear();
+	const HaploLayer &last = m_layers[geno_len];
+	if (n <= 0 || last.empty()) return 0;
+	samples.assign(n, Genotype(geno_len));
+	m_draw_pair.resize(n);
+	m_draw_swapped.assign(n, 0);
+	for (s=0; s<n; ++s) {
+		m_draw_pair[s] = choose(last.forward_likelihood, 0, last.size());
+	}
+	for (i=geno_len; i>head_len; --i) {
+		const HaploLayer &hl = m_layers[i];
+		const HaploLayer &prev = m_layers[i-1];
+		locus = i - 1;
+		indexPredecessors(i);
+		for (s=0; s<n; ++s) {
+			Genotype &g = samples[s];
+			k = m_draw_pair[s];
+			g(m_draw_swapped[s])[locus] = hl.allele_a[k];
+			g(1-m_draw_swapped[s])[locus] = hl.allele_b[k];
+			m_weight.clear();
+			for (l=m_pred_start[k]; l<m_pred_start[k+1]; ++l) {
+				m_weight.push_back(prev.forward_likelihood[m_pred_link[l]/2]);
+			}
+			l = m_pred_start[k] + choose(m_weight, 0, m_weight.size());
+			j = m_pred_link[l] / 2;
+			if (m_pred_link[l] % 2) m_draw_swapped[s] = 1 - m_draw_swapped[s];
+			m_draw_pair[s] = j;
+		}
+	}
+	const HaploLayer &head = m_layers[head_len];
+	for (s=0; s<n; ++s) {
+		Genotype &g = samples[s];
+		const HaploPattern &pa = *head.pattern_a[m_draw_pair[s]];
+		const HaploPattern &pb = *head.pattern_b[m_draw_pair[s]];
+		copy(&pa[0], &pa[0]+head_len-pa.start(), &g(m_draw_swapped[s])[pa.start()]);
+		copy(&pb[0], &pb[0]+head_len-pb.start(), &g(1-m_draw_swapped[s])[pb.start()]);
+		g.checkGenotype();
+		g.setPosteriorProbability(1.0 / n);
+	}
+	return 1.0;
+}
+
+// list the links from layer i-1 into each pair k of layer i as
+// m_pred_link[m_pred_start[k] .. m_pred_start[k+1]), each 2*source+reversed
+void HaploLattice::indexPredecessors(int i)
+{
+	const HaploLayer &prev = m_layers[i-1];
+	int j, k, l, n;
+	n = m_layers[i].size();
+	m_pred_start.assign(n+1, 0);
+	for (l=0; l<prev.link_target.size(); ++l) {
+		++m_pred_start[prev.link_target[l]+1];
+	}
+	for (k=0; k<n; ++k) {
+		m_pred_start[k+1] += m_pred_start[k];
+	}
+	m_pred_link.resize(prev.link_target.size());
+	for (j=0; j<prev.size(); ++j) {
+		for (l=prev.forward_begin(j); l<prev.reversed_end(j); ++l) {
+			k = prev.link_target[l];
+			m_pred_link[m_pred_start[k]++] = 2 * j + (l >= prev.reversed_begin(j) ? 1 : 0);
+		}
+	}
+	for (k=n; k>0; --k) {
+		m_pred_start[k] = m_pred_start[k-1];
+	}
+	m_pred_start[0] = 0;
+}
+
+// an index in [begin, end) drawn in proportion to likelihood
+int HaploLattice::choose(const vector<double> &likelihood, int begin, int end)
+{
+	int j;
+	double total = 0;
+	for (j=begin; j<end; ++j) {
+		total += likelihood[j];
+	}
+	double u = (m_random() + 0.5) / 4294967296.0 * total;
+	for (j=begin; j<end-1; ++j) {
+		u -= likelihood[j];
+		if (u < 0) break;
+	}
+	return j;
+}
+
+void HaploLattice::calcBackwardLikelihood()
+{
+	int head_len = m_builder.pattern_manager().head_len();
+	int i, j, k, n;
+	for (i=m_builder.genotype_len()-1; i>=head_len; --i) {
+		HaploLayer &hl = m_layers[i];
+		const HaploLayer &next = m_layers[i+1];
+		double factor = ldexp(1.0, -next.scale);
+		n = next.size();
+		m_weight.resize(n);
+		for (k=0; k<n; ++k) {
+			m_weight[k] = next.backward_likelihood[k] * next.transition_prob[k] * factor;
+		}
+		n = hl.size();
+		for (j=0; j<n; ++j) {
+			double likelihood = 0;
+			for (k=hl.forward_begin(j); k<hl.reversed_end(j); ++k) {
+				likelihood += m_weight[hl.link_target[k]];
+			}
+			hl.backward_likelihood[j] = likelihood;
+		}
+	}
+}
+
+// Per locus confidence of resolution, the best configuration of genotype
+// from the last resolve(), after calcBackwardLikelihood(): at a heterozygous
+// locus, the posterior probability that the phase switches from that of the
+// previous heterozygous locus (none at the first); at a locus with a
+// missing allele, the posterior probability of the imputed alleles; -1 at
+// other loci.
+void HaploLattice::calcConfidence(const Genotype &genotype, const Genotype &resolution, vector<double> &confidence)
+{
+	int geno_len = m_builder.genotype_len();
+	int l, p = -1;
+	confidence.assign(geno_len, -1.0);
+	if (m_layers[geno_len].empty()) return;
+	for (l=0; l<geno_len; ++l) {
+		if (genotype.hasMissing(l)) {
+			confidence[l] = calcAllelePosterior(l, resolution(0)[l], resolution(1)[l]);
+		}
+		else if (genotype.isHeterozygous(l)) {
+			if (p >= 0) confidence[l] = calcSwitchPosterior(p, l, resolution);
+			p = l;
+		}
+	}
+}
+
+// the first layer whose pairs cover locus
+int HaploLattice::layerOf(int locus) const
+{
+	return max(locus+1, m_builder.pattern_manager().head_len());
+}
+
+// the allele at locus on side 0 (pattern_a) or 1 (pattern_b) of pair j
+Allele HaploLattice::alleleAt(const HaploLayer &hl, int j, int side, int locus) const
+{
+	if (locus >= m_builder.pattern_manager().head_len()) {
+		return side ? hl.allele_b[j] : hl.allele_a[j];
+	}
+	const HaploPattern &hp = side ? *hl.pattern_b[j] : *hl.pattern_a[j];
+	return hp[locus-hp.start()];
+}
+
+double HaploLattice::calcAllelePosterior(int locus, const Allele &a1, const Allele &a2) const
+{
+	const HaploLayer &hl = m_layers[layerOf(locus)];
+	int j, n;
+	double total = 0, match = 0;
+	n = hl.size();
+	for (j=0; j<n; ++j) {
+		double w = hl.forward_likelihood[j] * hl.backward_likelihood[j];
+		Allele a = alleleAt(hl, j, 0, locus);
+		Allele b = alleleAt(hl, j, 1, locus);
+		total += w;
+		if ((a == a1 && b == a2) || (a == a2 && b == a1)) match += w;
+	}
+	return total > 0 ? match / total : 0;
+}
+
+// The forward likelihoods at heterozygous locus p are split by the side
+// carrying the allele of resolution(0) there and carried forward to locus q,
+// swapping sides along reversed links; with the backward likelihoods at q
+// this gives the posterior of both alleles of resolution(0) sharing a
+// haplotype.
+double HaploLattice::calcSwitchPosterior(int p, int q, const Genotype &resolution)
+{
+	int i, j, k, t, s, n, last;
+	i = layerOf(p);
+	last = layerOf(q);
+	const HaploLayer &first = m_layers[i];
+	n = first.size();
+	for (s=0; s<2; ++s) m_side_weight[s].assign(n, 0);
+	for (j=0; j<n; ++j) {
+		s = alleleAt(first, j, 0, p) == resolution(0)[p] ? 0 : 1;
+		m_side_weight[s][j] = first.forward_likelihood[j];
+	}
+	for (; i<last; ++i) {
+		const HaploLayer &hl = m_layers[i];
+		const HaploLayer &next = m_layers[i+1];
+		double factor = ldexp(1.0, -next.scale);
+		for (s=0; s<2; ++s) m_next_weight[s].assign(next.size(), 0);
+		n = hl.size();
+		for (j=0; j<n; ++j) {
+			for (t=hl.forward_begin(j); t<hl.forward_end(j); ++t) {
+				k = hl.link_target[t];
+				m_next_weight[0][k] += m_side_weight[0][j] * next.transition_prob[k] * factor;
+				m_next_weight[1][k] += m_side_weight[1][j] * next.transition_prob[k] * factor;
+			}
+			for (t=hl.reversed_begin(j); t<hl.reversed_end(j); ++t) {
+				k = hl.link_target[t];
+				m_next_weight[0][k] += m_side_weight[1][j] * next.transition_prob[k] * factor;
+				m_next_weight[1][k] += m_side_weight[0][j] * next.transition_prob[k] * factor;
+			}
+		}
+		for (s=0; s<2; ++s) m_side_weight[s].swap(m_next_weight[s]);
+	}
+	const HaploLayer &hl = m_layers[last];
+	double total = 0, same = 0;
+	n = hl.size();
+	for (j=0; j<n; ++j) {
+		for (s=0; s<2; ++s) {
+			double w = m_side_weight[s][j] * hl.backward_likelihood[j];
+			total += w;
+			if (alleleAt(hl, j, s, q) == resolution(0)[q]) same += w;
+		}
+	}
+	return total > 0 ? 1.0 - same / total : 0;
+}
@@ -0,0 +1,137 @@
+#ifndef __HAPLOLATTICE_H
+#define __HAPLOLATTICE_H
+
+
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+
+#include "Utils.h"
+#include "Allele.h"
+#include "Genotype.h"
+#include "HaploPattern.h"
+#include "HaploLayer.h"
+
+
+class HaploBuilder;
+struct PatternSuccessor;
+
+
+// Open addressing map (id_a, id_b) -> index of the haplotype pair in its
+// layer.  Entries carry a generation stamp, so clear() is O(1).
+
+class HaploPairIndex {
+	struct Entry {
+		unsigned int generation;
+		int id_a, id_b;
+		int value;
+	};
+
+	vector<Entry> m_table;
+	unsigned int m_generation;
+	int m_size;
+
+public:
+	explicit HaploPairIndex(int capacity = 1024);
+
+	int size() const { return m_size; }
+
+	void clear();
+	int &operator ()(int id_a, int id_b);
+
+protected:
+	int probe(int id_a, int id_b) const;
+	void rehash(int capacity);
+};
+
+inline int HaploPairIndex::probe(int id_a, int id_b) const
+{
+	unsigned int mask = m_table.size() - 1;
+	unsigned int i = ((unsigned int) id_a * 0x9E3779B1u ^ (unsigned int) id_b * 0x85EBCA77u) & mask;
+	while (m_table[i].generation == m_generation && (m_table[i].id_a != id_a || m_table[i].id_b != id_b)) {
+		i = (i + 1) & mask;
+	}
+	return i;
+}
+
+inline int &HaploPairIndex::operator ()(int id_a, int id_b)
+{
+	if (2 * (m_size + 1) > m_table.size()) {
+		rehash(2 * m_table.size());
+	}
+	Entry &e = m_table[probe(id_a, id_b)];
+	if (e.generation != m_generation) {				// new entry
+		e.generation = m_generation;
+		e.id_a = id_a;
+		e.id_b = id_b;
+		e.value = -1;
+		++m_size;
+	}
+	return e.value;
+}
+
+
+class HaploLattice {
+	const HaploBuilder &m_builder;
+
+	vector<HaploLayer> m_layers;
+	HaploPairIndex m_best_pair;
+	vector<int> m_link_source, m_link_target;
+	vector<char> m_link_reversed;
+	vector<HaploPairLink> m_link_buffer, m_zero_links;
+	vector<double> m_weight;
+	vector<int> m_index;
+	vector<int> m_pred_start, m_pred_link;
+	vector<int> m_draw_pair;
+	vector<char> m_draw_swapped;
+	vector<double> m_side_weight[2], m_next_weight[2];
+	boost::mt19937 m_random;
+	double m_likelihood;
+	double m_discarded;
+	int m_scale;
+	int m_sample_size;
+
+public:
+	explicit HaploLattice(const HaploBuilder &hb);
+	~HaploLattice();
+
+	const HaploLayer &layer(int i) const { return m_layers[i]; }
+
+	// likelihood of the last resolved genotype divided by 2^scale(),
+	// backward likelihoods are scaled to match it
+	double likelihood() const { return m_likelihood; }
+	int scale() const { return m_scale; }
+
+	// fraction of the forward likelihood dropped by beam pruning
+	double discarded() const { return m_discarded; }
+
+	double resolve(const Genotype &genotype, Genotype &resolution, vector<Genotype> &res_list, int sample_size = 1);
+
+	Genotype getGenotype(int i, int j, int index = 0) const;
+
+	double drawSamples(int n, vector<Genotype> &samples);
+
+	void calcBackwardLikelihood();
+	void calcConfidence(const Genotype &genotype, const Genotype &resolution, vector<double> &confidence);
+
+protected:
+	void initialize();
+	void initHeadList(const Genotype &genotype);
+
+	void extendAll(int i, int a1, int a2);
+	void extend(int i, int j, int a1, int a2);
+	void addHaploPair(int i, int j, const PatternSuccessor &psa, const PatternSuccessor &psb);
+	void prune(int i);
+	void indexPredecessors(int i);
+	int choose(const vector<double> &likelihood, int begin, int end);
+	int layerOf(int locus) const;
+	Allele alleleAt(const HaploLayer &hl, int j, int side, int locus) const;
+	double calcAllelePosterior(int locus, const Allele &a1, const Allele &a2) const;
+	double calcSwitchPosterior(int p, int q, const Genotype &resolution);
+
+private:
+	HaploLattice(const HaploLattice &);
+	HaploLattice &operator=(const HaploLattice &);
+};
+
+
+#endif // __HAPLOLATTICE_H
@@ -0,0 +1,170 @@
+#include "HaploLayer.h"
+
+#include <cmath>
+
+#include "MemLeak.h"
+
+
+////////////////////////////////
+//
+// struct HaploLayer
+
+void HaploLayer::clear(int n)
+{
+	pattern_a.clear();
+	pattern_b.clear();
+	allele_a.clear();
+	allele_b.clear();
+	transition_prob.clear();
+	forward_likelihood.clear();
+	backward_likelihood.clear();
+	link_start.assign(1, 0);
+	link_target.clear();
+	best_num.clear();
+	best_size = n > 1 ? n : 1;
+	scale = 0;
+}
+
+int HaploLayer::add(const HaploPattern *hpa, const HaploPattern *hpb, double p)
+{
+	pattern_a.push_back(hpa);
+	pattern_b.push_back(hpb);
+	allele_a.push_back((*hpa)[hpa->length()-1]);
+	allele_b.push_back((*hpb)[hpb->length()-1]);
+	transition_prob.push_back(p);
+	forward_likelihood.push_back(0);
+	backward_likelihood.push_back(1.0);
+	link_start.push_back(0);
+	link_start.push_back(0);
+	best_num.push_back(0);
+	int n = size();
+	if (best_links.size() < n * best_size) {
+		best_links.resize(max(n * best_size, 2 * (int) best_links.size()));
+	}
+	return n - 1;
+}
+
+// keep the pairs with index[j] >= 0 and set index[j] to their new position
+int HaploLayer::compact(vector<int> &index)
+{
+	int i, j, k, n;
+	n = size();
+	for (j=0, k=0; j<n; ++j) {
+		if (index[j] < 0) continue;
+		if (k < j) {
+			pattern_a[k] = pattern_a[j];
+			pattern_b[k] = pattern_b[j];
+			allele_a[k] = allele_a[j];
+			allele_b[k] = allele_b[j];
+			transition_prob[k] = transition_prob[j];
+			forward_likelihood[k] = forward_likelihood[j];
+			backward_likelihood[k] = backward_likelihood[j];
+			for (i=0; i<best_num[j]; ++i) {
+				best(k)[i] = best(j)[i];
+			}
+			best_num[k] = best_num[j];
+		}
+		index[j] = k++;
+	}
+	pattern_a.resize(k);
+	pattern_b.resize(k);
+	allele_a.resize(k);
+	allele_b.resize(k);
+	transition_prob.resize(k);
+	forward_likelihood.resize(k);
+	backward_likelihood.resize(k);
+	link_start.assign(2*k+1, 0);
+	best_num.resize(k);
+	return k;
+}
+
+void HaploLayer::rescale()
+{
+	int i, j, n;
+	double max_likelihood = 0;
+	n = size();
+	for (j=0; j<n; ++j) {
+		if (forward_likelihood[j] > max_likelihood) max_likelihood = forward_likelihood[j];
+	}
+	scale = 0;
+	if (max_likelihood > 0) frexp(max_likelihood, &scale);
+	if (scale == 0) return;
+	double factor = ldexp(1.0, -scale);
+	for (j=0; j<n; ++j) {
+		forward_likelihood[j] *= factor;
+		HaploPairLink *links = best(j);
+		for (i=0; i<best_num[j]; ++i) {
+			links[i].likelihood *= factor;
+		}
+	}
+}
+
+// merge links[0 .. n), most likely first, into the best links of pair j,
+// keeping the best_size most likely in place; ties keep the links already there
+void HaploLayer::mergeLinks(int j, const HaploPairLink *links, int n)
+{
+	HaploPairLink *dest = best(j);
+	int m = best_num[j];
+	int len = min(m + n, best_size);
+	int a = m - 1, b = n - 1, k;
+	for (k=m+n; k>len; --k) {							// drop the least likely
+		if (b < 0 || (a >= 0 && dest[a].likelihood < links[b].likelihood)) {
+			--a;
+		}
+		else {
+			--b;
+		}
+	}
+	for (k=len-1; b>=0; --k) {							// fill from the back
+		if (a >= 0 && dest[a].likelihood < links[b].likelihood) {
+			dest[k] = dest[a--];
+		}
+		else {
+			dest[k] = links[b--];
+		}
+	}
+	best_num[j] = len;
+}
+
+void HaploLayer::setLinks(const vector<int> &source, const vector<int> &target, const vector<char> &reversed)
+{
+	int i, key;
+	int n = 2 * size();
+	int m = source.size();
+	link_start.assign(n+1, 0);
+	for (i=0; i<m; ++i) {								// count links per (source, reversed)
+		++link_start[2*source[i]+reversed[i]+1];
+	}
+	for (i=0; i<n; ++i) {
+		link_start[i+1] += link_start[i];
+	}
+	link_target.resize(m);
+	for (i=0; i<m; ++i) {								// stable, so links keep their order
+		key = 2*source[i]+reversed[i];
+		link_target[link_start[key]++] = target[i];
+	}
+	for (i=n; i>0; --i) {
+		link_start[i] = link_start[i-1];
+	}
+	link_start[0] = 0;
+}
+
+
+////////////////////////////////
+//
+// struct PairWeights
+
+void PairWeights::reset(int n)
+{
+	int i, m;
+	m = index.size();
+	for (i=0; i<m; ++i) {
+		weight[index[i]] = 0;
+		used[index[i]] = 0;
+	}
+	index.clear();
+	if (weight.size() < n) {
+		weight.resize(n, 0);
+		used.resize(n, 0);
+	}
+}
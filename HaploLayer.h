@@ -0,0 +1,136 @@
+#ifndef __HAPLOLAYER_H
+#define __HAPLOLAYER_H
+
+
+#include <vector>
+#include <algorithm>
+
+#include "Utils.h"
+#include "Allele.h"
+#include "HaploPattern.h"
+
+
+struct HaploPairLink {
+	int link;
+	int index;
+	bool reversed;
+	bool homozygous;
+	double likelihood;
+
+	HaploPairLink() : link(-1), index(0), reversed(false), homozygous(false), likelihood(0) {}
+	HaploPairLink(int hp, int i, bool r, bool h, double l);
+
+	void set(int hp, int i, bool r, bool h, double l);
+
+	friend bool operator <(const HaploPairLink &lhs, const HaploPairLink &rhs);
+	friend bool operator >(const HaploPairLink &lhs, const HaploPairLink &rhs);
+};
+
+inline HaploPairLink::HaploPairLink(int hp, int i, bool r, bool h, double l)
+: link(hp), index(i), reversed(r), homozygous(h), likelihood(l)
+{
+}
+
+inline void HaploPairLink::set(int hp, int i, bool r, bool h, double l)
+{
+	link = hp;
+	index = i;
+	reversed = r;
+	homozygous = h;
+	likelihood = l;
+}
+
+inline bool operator <(const HaploPairLink &lhs, const HaploPairLink &rhs)
+{
+	return (lhs.likelihood < rhs.likelihood);
+}
+
+inline bool operator >(const HaploPairLink &lhs, const HaploPairLink &rhs)
+{
+	return (lhs.likelihood > rhs.likelihood);
+}
+
+
+// All haplotype pairs ending at one locus, stored column by column.
+// Pair j is (pattern_a[j], pattern_b[j]) with pattern_a[j]->id() <= pattern_b[j]->id().
+// Its successors in the next layer are link_target[link_start[2*j] .. link_start[2*j+1])
+// and, with the two patterns swapped, link_target[link_start[2*j+1] .. link_start[2*j+2]).
+// Each pair keeps up to best_size best traceback links in
+// best_links[j*best_size .. j*best_size+best_num[j]), where link indexes
+// the previous layer (-1 for head pairs), most likely first.  best_links
+// only grows, so once a lattice has resolved a genotype later layers reuse
+// its storage without constructing links.
+// Forward likelihoods and best link likelihoods of a layer are divided by
+// 2^scale after the layer is built (see rescale()), so long genotypes do
+// not underflow; a power of two keeps the rescaling exact.
+
+struct HaploLayer {
+	vector<const HaploPattern*> pattern_a, pattern_b;
+	vector<Allele> allele_a, allele_b;
+	vector<double> transition_prob;
+	vector<double> forward_likelihood;
+	vector<double> backward_likelihood;
+	vector<int> link_start;
+	vector<int> link_target;
+	vector<HaploPairLink> best_links;
+	vector<int> best_num;
+	int best_size;
+	int scale;
+
+	HaploLayer() : best_size(1), scale(0) { }
+
+	int size() const { return forward_likelihood.size(); }
+	bool empty() const { return forward_likelihood.empty(); }
+
+	int forward_begin(int j) const { return link_start[2*j]; }
+	int forward_end(int j) const { return link_start[2*j+1]; }
+	int reversed_begin(int j) const { return link_start[2*j+1]; }
+	int reversed_end(int j) const { return link_start[2*j+2]; }
+
+	const HaploPairLink *best(int j) const { return &best_links[j*best_size]; }
+	HaploPairLink *best(int j) { return &best_links[j*best_size]; }
+
+	void clear(int best_size);
+	int add(const HaploPattern *hpa, const HaploPattern *hpb, double transition_prob);
+	bool acceptsLink(int j, double likelihood) const;
+	void mergeLinks(int j, const HaploPairLink *links, int n);
+	int compact(vector<int> &index);
+	void rescale();
+	void setLinks(const vector<int> &source, const vector<int> &target, const vector<char> &reversed);
+};
+
+// whether a link with this likelihood would be among the best of pair j
+inline bool HaploLayer::acceptsLink(int j, double likelihood) const
+{
+	return best_num[j] < best_size || likelihood > best(j)[best_num[j]-1].likelihood;
+}
+
+
+// Sparse weights over the pairs of one layer, kept in a dense vector so
+// adding is O(1).  index lists the pairs with a weight in the order they
+// were first added; reset() clears only those, so the buffers can be
+// reused across layers without touching every entry.
+
+struct PairWeights {
+	vector<double> weight;
+	vector<char> used;
+	vector<int> index;
+
+	bool empty() const { return index.empty(); }
+
+	void reset(int n);
+	void add(int j, double w);
+	void sort() { std::sort(index.begin(), index.end()); }
+};
+
+inline void PairWeights::add(int j, double w)
+{
+	if (!used[j]) {
+		used[j] = 1;
+		index.push_back(j);
+	}
+	weight[j] += w;
+}
+
+
+#endif // __HAPLOLAYER_H
@@ -2,15 +2,141 @@
 #include "HaploModel.h"
 #include "GenoData.h"
 #include "HaploComp.h"
+#include "ModelFile.h"
+#include "Parallel.h"
 
 #include <cfloat>
 
 #include "MemLeak.h"
 
 
+class ResolveWorker {
+	HaploLattice &m_lattice;
+	WorkQueue &m_queue;
+	const GenoData &m_genos;
+	const vector<int> &m_unphased;
+	GenoData &m_resolutions;
+	vector<vector<Genotype> > &m_res_lists;
+	vector<double> &m_coverages;
+	vector<double> &m_discarded;
+	vector<vector<double> > *m_confidence;
+	int m_sample_size;
+	int m_posterior_samples;
+
+public:
+	ResolveWorker(HaploLattice &hl, WorkQueue &queue, const GenoData &genos, const vector<int> &unphased,
+		GenoData &resolutions, vector<vector<Genotype> > &res_lists, vector<double> &coverages,
+		vector<double> &discarded, vector<vector<double> > *confidence, int sample_size, int posterior_samples)
+		: m_lattice(hl), m_queue(queue), m_genos(genos), m_unphased(unphased), m_resolutions(resolutions),
+		  m_res_lists(res_lists), m_coverages(coverages), m_discarded(discarded), m_confidence(confidence),
+		  m_sample_size(sample_size), m_posterior_samples(posterior_samples) { }
+
+	void operator()();
+};
+
+void ResolveWorker::operator()()
+{
+	int i, k;
+	while (!HaploModel::terminated() && m_queue.fetch(k)) {
+		i = m_unphased[k];
+		Logger::status("  Resolving Genotype[%d] %s ...", i, m_genos[i].id().c_str());
+		if (m_posterior_samples > 0) {				// the best configuration, then posterior draws
+			m_lattice.resolve(m_genos[i], m_resolutions[i], m_res_lists[k], 1);
+		}
+		else {
+			m_coverages[k] = m_lattice.resolve(m_genos[i], m_resolutions[i], m_res_lists[k], m_sample_size);
+		}
+		if (m_confidence) {
+			m_lattice.calcBackwardLikelihood();
+			m_lattice.calcConfidence(m_genos[i], m_resolutions[i], (*m_confidence)[i]);
+		}
+		if (m_posterior_samples > 0) {
+			m_coverages[k] = m_lattice.drawSamples(m_posterior_samples, m_res_lists[k]);
+		}
+		m_resolutions[i].setID(m_genos[i].id());
+		m_discarded[k] = m_lattice.discarded();
+	}
+}
+
+
+// resolves genotypes against fixed patterns, keeping only whether each was
+// resolved so memory does not grow with the sample size
+
+class PhaseWorker {
+	HaploLattice &m_lattice;
+	WorkQueue &m_queue;
+	const GenoData &m_genos;
+	const vector<int> &m_targets;
+	GenoData &m_resolutions;
+	vector<char> &m_resolved;
+	vector<vector<double> > *m_confidence;
+	int m_sample_size;
+
+public:
+	PhaseWorker(HaploLattice &hl, WorkQueue &queue, const GenoData &genos, const vector<int> &targets,
+		GenoData &resolutions, vector<char> &resolved, vector<vector<double> > *confidence, int sample_size)
+		: m_lattice(hl), m_queue(queue), m_genos(genos), m_targets(targets), m_resolutions(resolutions),
+		  m_resolved(resolved), m_confidence(confidence), m_sample_size(sample_size) { }
+
+	void operator()();
+};
+
+void PhaseWorker::operator()()
+{
+	int i, k;
+	vector<Genotype> res_list;
+	while (m_queue.fetch(k)) {
+		i = m_targets[k];
+		Logger::status("  Phasing Genotype[%d] %s ...", i, m_genos[i].id().c_str());
+		m_lattice.resolve(m_genos[i], m_resolutions[i], res_list, m_sample_size);
+		m_resolutions[i].setID(m_genos[i].id());
+		m_resolved[k] = !res_list.empty();
+		if (m_confidence) {
+			m_lattice.calcBackwardLikelihood();
+			m_lattice.calcConfidence(m_genos[i], m_resolutions[i], (*m_confidence)[i]);
+		}
+	}
+}
+
+
+class WindowWorker {
+	const HaploModel &m_model;
+	WorkQueue &m_queue;
+	const GenoData &m_genos;
+	const vector<pair<int, int> > &m_windows;
+	vector<GenoData> &m_resolutions;
+
+public:
+	WindowWorker(const HaploModel &hm, WorkQueue &queue, const GenoData &genos,
+		const vector<pair<int, int> > &windows, vector<GenoData> &resolutions)
+		: m_model(hm), m_queue(queue), m_genos(genos), m_windows(windows), m_resolutions(resolutions) { }
+
+	void operator()();
+};
+
+void WindowWorker::operator()()
+{
+	int k;
+	while (m_queue.fetch(k)) {
+		GenoData window, unphased;
+		HaploModel model;
+		window.assign(m_genos, m_windows[k].first, m_windows[k].second);
+		unphased = window;
+		model.copyParameters(m_model);
+		model.build(unphased);
+		m_resolutions[k] = unphased;
+		model.iterate(window, unphased, m_resolutions[k]);
+	}
+}
+
+
+volatile sig_atomic_t HaploModel::m_terminated = 0;
+
 HaploModel::HaploModel()
 {
 	m_model = "MV";
+	m_fixed = false;
+	m_resume = false;
 	min_freq = -1;
 	num_patterns = -1;
 	min_pattern_len = 1;
@@ -21,7 +147,11 @@ HaploModel::HaploModel()
 	sample_size = 1;
 	max_sample_size = 1;
 	final_sample_size = 1;
+	posterior_samples = 0;
 	exact_estimate = false;
+	site_confidence = false;
+	window_size = 0;
+	window_overlap = 0;
 }
 
 void HaploModel::setModel(string model)
@@ -38,15 +168,7 @@ void HaploModel::setModel(string model)
 void HaploModel::build(GenoData &genos)
 {
 	setGenoData(genos);
-
-	Logger::info("");
-	Logger::info("Running HMC engine %s ...", m_model.c_str());
-	Logger::verbose("");
-	Logger::beginTimer(1, "Search Haplotype pattern");
-
 	findPatterns();
-
-	Logger::endTimer(1);
 }
 
 void HaploModel::findPatterns()
@@ -76,60 +198,118 @@ void HaploModel::findPatterns()
 	}
 }
 
-double HaploModel::resolveAll(GenoData &genos, GenoData &resolutions)
+// confidence, if given, receives the per locus confidence of each resolution
+double HaploModel::resolveAll(GenoData &genos, GenoData &resolutions, vector<vector<double> > *confidence)
 {
-	int i, j, n;
-	vector<Genotype> res_list;
-	double sampling_coverage;
+	int i, j, k, n;
+	vector<int> unphased;
+	vector<vector<Genotype> > res_lists;
+	vector<double> coverages;
+	vector<double> discarded;
 	double log_likelihood = 0;
-	samples()->clear();
 	for (i=0; i<genos.genotype_num(); ++i) {
 		if (!genos[i].isPhased()) {
-			Logger::status("  Resolving Genotype[%d] %s ...", i, genos[i].id().c_str());
-			sampling_coverage = resolve(genos[i], resolutions[i], res_list, sample_size);
-			resolutions[i].setID(genos[i].id());
-			if (res_list.empty()) {
-				Logger::warning("Unable to resolve Genotype[%d]: %s!", i, genos[i].id().c_str());
-			}
-			else {
-				n = res_list.size();
-				for (j=0; j<n; ++j) {
-					res_list[j](0).setWeight(res_list[j].posterior_probability() / sampling_coverage);
-					res_list[j](1).setWeight(res_list[j].posterior_probability() / sampling_coverage);
-// 					for (int k=0; k<genos.genotype_len(); ++k) {
-// 						if (genos[i].isMissing(k)) {
-// 							res_list[j](0)[k] = -1;
-// 							res_list[j](1)[k] = -1;
-// 						}
-// 					}
-					samples()->addHaplotype(res_list[j](0));
-					samples()->addHaplotype(res_list[j](1));
-				}
+			unphased.push_back(i);
+		}
+	}
+	res_lists.resize(unphased.size());
+	coverages.resize(unphased.size());
+	discarded.resize(unphased.size());
+	if (confidence) {
+		confidence->assign(genos.genotype_num(), vector<double>());
+	}
+	WorkQueue queue(unphased.size());
+	vector<ResolveWorker*> workers;
+	for (k=0; k<max(thread_num, 1); ++k) {
+		workers.push_back(new ResolveWorker(lattice(k), queue, genos, unphased, resolutions, res_lists, coverages,
+			discarded, confidence, sample_size, posterior_samples));
+	}
+	run_parallel(workers);
+	DeleteAll_Clear()(workers);
+	samples()->clear();
+	for (k=0; k<unphased.size(); ++k) {
+		i = unphased[k];
+		vector<Genotype> &res_list = res_lists[k];
+		if (res_list.empty()) {
+			Logger::warning("Unable to resolve Genotype[%d]: %s!", i, genos[i].id().c_str());
+		}
+		else {
+			n = res_list.size();
+			for (j=0; j<n; ++j) {
+				res_list[j](0).setWeight(res_list[j].posterior_probability() / coverages[k]);
+				res_list[j](1).setWeight(res_list[j].posterior_probability() / coverages[k]);
+				samples()->addHaplotype(res_list[j](0));
+				samples()->addHaplotype(res_list[j](1));
 			}
-			genos[i].setGenotypeProbability(resolutions[i].genotype_probability());
-			log_likelihood += log(resolutions[i].genotype_probability());
 		}
+		genos[i].setLogGenotypeProbability(resolutions[i].log_genotype_probability());
+		log_likelihood += resolutions[i].log_genotype_probability();
 	}
 	samples()->checkTotalWeight();
+	if (beam_width > 0 || beam_ratio > 0) {
+		double total = 0, max_discarded = 0;
+		for (k=0; k<discarded.size(); ++k) {
+			total += discarded[k];
+			if (discarded[k] > max_discarded) max_discarded = discarded[k];
+		}
+		if (!discarded.empty()) total /= discarded.size();
+		Logger::info("  Beam pruning discarded %g of the likelihood on average, %g at most", total, max_discarded);
+	}
 	return log_likelihood;
 }
 
 void HaploModel::run(const GenoData &genos, GenoData &resolutions)
 {
-	int iter;
-	double ll, old_ll;
-	GenoData unphased, resolved;
-	vector<Genotype> res_list;
+	Logger::info("");
+	Logger::info("Running HMC engine %s ...", m_model.c_str());
+	if (m_fixed) {
+		phase(genos, resolutions);
+	}
+	else if (window_size > 0 && genos.genotype_len() > window_size) {
+		runWindows(genos, resolutions);
+	}
+	else {
+		int iter = 0;
+		double ll = -DBL_MAX;
+		m_reference = genos;						// kept for the patterns after run()
+//		m_reference.randomizePhase();
+		if (!m_checkpoint.empty()) {
+			signal(SIGTERM, terminate);
+		}
+		if (m_resume) {
+			ModelFile(m_checkpoint).readCheckpoint(*this, m_reference, resolutions, iter, ll);
+			Logger::info("  Resuming after iteration %d from %s, LL = %f", iter, m_checkpoint.c_str(), ll);
+		}
+		else {
+			Logger::verbose("");
+			Logger::beginTimer(1, "Search Haplotype pattern");
+			build(m_reference);
+			Logger::endTimer(1);
+			resolutions = m_reference;
+			if (!m_checkpoint.empty()) {
+				saveCheckpoint(0, ll, resolutions);
+			}
+		}
+		iterate(genos, m_reference, resolutions, iter+1, ll);
+	}
+}
 
-	unphased = resolved = genos;
-//	unphased.randomizePhase();
-	build(unphased);
-	resolutions = unphased;
+// resolutions holds the best resolutions so far, the input ones at first
+void HaploModel::iterate(const GenoData &genos, GenoData &unphased, GenoData &resolutions, int first, double old_ll)
+{
+	int iter;
+	double ll;
+	GenoData resolved = genos;
+	vector<vector<double> > confidence;
 
-	old_ll = -DBL_MAX;
-	for (iter=1; iter<=max_iteration; ++iter) {
-		ll = resolveAll(unphased, resolved);
-		if (ll >= old_ll) resolutions = resolved;
+	m_confidence.clear();
+	for (iter=first; iter<=max_iteration; ++iter) {
+		ll = resolveAll(unphased, resolved, site_confidence ? &confidence : 0);
+		checkTerminated();
+		if (ll >= old_ll) {
+			resolutions = resolved;
+			m_confidence.swap(confidence);
+		}
 
 		HaploComp compare(&genos, &resolutions);
 		Logger::info("");
@@ -147,9 +327,220 @@ void HaploModel::run(const GenoData &genos, GenoData &resolutions)
 			if (m_model == "MA") {
 				m_patterns.adjustFrequency();
 			}
+			if (!m_checkpoint.empty()) {
+				saveCheckpoint(iter, old_ll, resolutions);
+			}
 		}
 		else {
 			break;
 		}
 	}
 }
+
+// Windows of window_size markers, adjacent ones sharing window_overlap
+// markers, are resolved independently in parallel.  Each window is then
+// oriented to agree with the phases already stitched together on most of
+// the heterozygous markers of their overlap, and takes over from the
+// middle of the overlap.
+void HaploModel::runWindows(const GenoData &genos, GenoData &resolutions)
+{
+	int i, j, k, l, n, len, step, start, cut;
+	vector<pair<int, int> > windows;
+	len = genos.genotype_len();
+	step = window_size - window_overlap;
+	for (start=0; ; start+=step) {
+		if (start + window_size >= len) {
+			windows.push_back(make_pair(len - window_size, window_size));
+			break;
+		}
+		windows.push_back(make_pair(start, window_size));
+	}
+	n = windows.size();
+	Logger::info("  Resolving %d windows of %d markers overlapping by %d markers", n, window_size, window_overlap);
+
+	vector<GenoData> window_res(n);
+	WorkQueue queue(n);
+	vector<WindowWorker*> workers;
+	for (k=0; k<min(max(thread_num, 1), n); ++k) {
+		workers.push_back(new WindowWorker(*this, queue, genos, windows, window_res));
+	}
+	run_parallel(workers);
+	DeleteAll_Clear()(workers);
+
+	resolutions = genos;
+	cut = 0;
+	for (k=0; k<n; ++k) {
+		start = windows[k].first;
+		const GenoData &res = window_res[k];
+		for (i=0; i<genos.genotype_num(); ++i) {
+			Genotype &g = resolutions[i];
+			const Genotype &w = res[i];
+			int same = 0, swapped = 0;
+			for (l=start; l<cut; ++l) {
+				if (g.isHeterozygous(l) && w.isHeterozygous(l-start)) {
+					if (g(0)[l] == w(0)[l-start]) {
+						++same;
+					}
+					else if (g(0)[l] == w(1)[l-start]) {
+						++swapped;
+					}
+				}
+			}
+			j = swapped > same ? 1 : 0;
+			for (l=(k>0 ? (start+cut)/2 : 0); l<start+windows[k].second; ++l) {
+				g(0)[l] = w(j)[l-start];
+				g(1)[l] = w(1-j)[l-start];
+			}
+		}
+		window_res[k] = GenoData();
+		cut = start + windows[k].second;
+	}
+	for (i=0; i<resolutions.genotype_num(); ++i) {
+		resolutions[i].checkGenotype();
+	}
+
+	HaploComp compare(&genos, &resolutions);
+	Logger::info("");
+	Logger::info("  Switch Error = %f, IHP = %f, IGP = %f",
+		compare.switch_error(), compare.incorrect_haplotype_percentage(), compare.incorrect_genotype_percentage());
+}
+
+// the parameters of hm, for a model resolving one window in one thread
+void HaploModel::copyParameters(const HaploModel &hm)
+{
+	m_model = hm.m_model;
+	min_freq = hm.min_freq;
+	min_freq_abs = hm.min_freq_abs;
+	num_patterns = hm.num_patterns;
+	min_pattern_len = hm.min_pattern_len;
+	max_pattern_len = hm.max_pattern_len;
+	mc_order = hm.mc_order;
+	max_iteration = hm.max_iteration;
+	min_iteration = hm.min_iteration;
+	sample_size = hm.sample_size;
+	max_sample_size = hm.max_sample_size;
+	final_sample_size = hm.final_sample_size;
+	posterior_samples = hm.posterior_samples;
+	exact_estimate = hm.exact_estimate;
+	site_confidence = false;
+	beam_width = hm.beam_width;
+	beam_ratio = hm.beam_ratio;
+	thread_num = 1;
+	window_size = 0;
+	window_overlap = 0;
+}
+
+// learn the patterns once from a phased reference panel; run() then phases
+// its genotypes against them
+void HaploModel::buildReference(const GenoData &reference)
+{
+	m_reference = reference;
+	for (int i=0; i<m_reference.genotype_num(); ++i) {
+		m_reference[i].setIsPhased(true);
+	}
+	Logger::verbose("");
+	Logger::beginTimer(1, "Search Haplotype pattern");
+	build(m_reference);
+	Logger::endTimer(1);
+	m_fixed = true;
+	Logger::info("Built model with %d patterns from %d reference haplotypes.", pattern_num(), 2 * genotype_num());
+}
+
+void HaploModel::loadModel(const string &filename)
+{
+	ModelFile(filename).read(*this, m_reference);
+	m_fixed = true;
+	Logger::info("Loaded model with %d patterns over %d markers.", pattern_num(), genotype_len());
+}
+
+void HaploModel::saveModel(const string &filename) const
+{
+	ModelFile(filename).write(*this);
+}
+
+void HaploModel::setCheckpoint(const string &filename, bool resume)
+{
+	m_checkpoint = filename;
+	m_resume = resume;
+}
+
+// the state after iteration, with the patterns for the next one; exits
+// after writing it if the run was terminated meanwhile
+void HaploModel::saveCheckpoint(int iteration, double log_likelihood, const GenoData &resolutions)
+{
+	ModelFile(m_checkpoint).writeCheckpoint(*this, resolutions, iteration, log_likelihood);
+	Logger::verbose("  Checkpoint after iteration %d written to %s", iteration, m_checkpoint.c_str());
+	checkTerminated();
+}
+
+void HaploModel::checkTerminated() const
+{
+	if (m_terminated) {
+		Logger::warning("Terminated, continue with --resume from %s", m_checkpoint.c_str());
+		exit(1);
+	}
+}
+
+// only flags the run, which stops at the next checkpoint or iteration
+void HaploModel::terminate(int signal)
+{
+	m_terminated = 1;
+}
+
+// resolve genos against the patterns as they are, without learning from genos
+void HaploModel::phase(const GenoData &genos, GenoData &resolutions)
+{
+	int i, j, k, l;
+	vector<int> targets;
+	vector<char> resolved;
+	double log_likelihood = 0;
+	if (genos.genotype_len() != genotype_len()) {
+		Logger::error("The genotypes have %d markers but the model has %d!", genos.genotype_len(), genotype_len());
+		exit(1);
+	}
+	for (i=0; i<genos.genotype_num(); ++i) {
+		if (genos[i].isPhased()) continue;
+		for (j=0; j<2; ++j) {
+			for (l=0; l<genotype_len(); ++l) {
+				Allele a = genos[i](j)[l];
+				if (!a.isMissing() && this->genos()->getAlleleIndex(l, a) < 0) break;
+			}
+			if (l < genotype_len()) break;
+		}
+		if (j < 2) {
+			Logger::warning("Genotype[%d] %s has alleles not in the model!", i, genos[i].id().c_str());
+		}
+		else {
+			targets.push_back(i);
+		}
+	}
+	resolved.resize(targets.size());
+	resolutions = genos;
+	m_confidence.clear();
+	if (site_confidence) {
+		m_confidence.resize(genos.genotype_num());
+	}
+	WorkQueue queue(targets.size());
+	vector<PhaseWorker*> workers;
+	for (k=0; k<max(thread_num, 1); ++k) {
+		workers.push_back(new PhaseWorker(lattice(k), queue, genos, targets, resolutions, resolved,
+			site_confidence ? &m_confidence : 0, sample_size));
+	}
+	run_parallel(workers);
+	DeleteAll_Clear()(workers);
+	for (k=0; k<targets.size(); ++k) {
+		i = targets[k];
+		if (!resolved[k]) {
+			Logger::warning("Unable to resolve Genotype[%d]: %s!", i, genos[i].id().c_str());
+			resolutions[i] = genos[i];
+		}
+		else {
+			log_likelihood += resolutions[i].log_genotype_probability();
+		}
+	}
+
+	HaploComp compare(&genos, &resolutions);
+	Logger::info("");
+	Logger::info("  Switch Error = %f, IHP = %f, IGP = %f, LL = %f",
+		compare.switch_error(), compare.incorrect_haplotype_percentage(), compare.incorrect_genotype_percentage(), log_likelihood);
+}
@@ -3,13 +3,26 @@
 #define __HAPLOMODEL_H
 
 
+#include <cfloat>
+#include <csignal>
+
 #include "Utils.h"
+#include "GenoData.h"
 #include "HaploBuilder.h"
 
 
 class HaploModel : public HaploBuilder {
+	friend class WindowWorker;
+
 protected:
 	string m_model;
+	GenoData m_reference;						// the genotypes or allele tables the patterns refer to
+	bool m_fixed;								// patterns are loaded, not learned
+	vector<vector<double> > m_confidence;		// per locus confidence of the resolutions
+	string m_checkpoint;						// written after each iteration if not empty
+	bool m_resume;								// continue from m_checkpoint
+
+	static volatile sig_atomic_t m_terminated;
 
 public:
 	double min_freq;
@@ -23,20 +36,41 @@ public:
 	int sample_size;
 	int max_sample_size;
 	int final_sample_size;
+	int posterior_samples;
 	bool exact_estimate;
+	bool site_confidence;
+	int window_size;
+	int window_overlap;
 
 public:
 	HaploModel();
 
 	void setModel(string model);
 
+	const vector<vector<double> > &confidence() const { return m_confidence; }
+
 	void run(const GenoData &genos, GenoData &resolutions);
 
+	void buildReference(const GenoData &reference);
+	void loadModel(const string &filename);
+	void saveModel(const string &filename) const;
+	void setCheckpoint(const string &filename, bool resume);
+
+	static bool terminated() { return m_terminated != 0; }
+
 protected:
 	void build(GenoData &genos);
 	void findPatterns();
+	void iterate(const GenoData &genos, GenoData &unphased, GenoData &resolutions, int first = 1, double old_ll = -DBL_MAX);
+	void runWindows(const GenoData &genos, GenoData &resolutions);
+	void copyParameters(const HaploModel &hm);
+	void phase(const GenoData &genos, GenoData &resolutions);
+	void saveCheckpoint(int iteration, double log_likelihood, const GenoData &resolutions);
+	void checkTerminated() const;
+
+	static void terminate(int signal);
 
-	double resolveAll(GenoData &genos, GenoData &resolutions);
+	double resolveAll(GenoData &genos, GenoData &resolutions, vector<vector<double> > *confidence = 0);
 };
 
 
@@ -5,8 +5,6 @@
 #include "MemLeak.h"
 
 
-boost::pool<> HaploPattern::m_pool(sizeof(HaploPattern));
-
 ////////////////////////////////
 //
 // class HaploPattern
@@ -4,7 +4,7 @@
 
 
 #include <list>
-#include <boost/pool/pool.hpp>
+#include <boost/pool/singleton_pool.hpp>
 
 #include "Utils.h"
 #include "Allele.h"
@@ -15,13 +15,11 @@
 
 class HaploPattern : public AlleleSequence, public NoThrowNewDelete {
 protected:
-	static boost::pool<> m_pool;
 	const GenoData &m_genos;
 	int m_start, m_end;
 	unsigned int m_id;
 	double m_frequency, m_prefix_freq;
 	double m_transition_prob;
-	vector<const HaploPattern*> m_successors;
 
 public:
 	explicit HaploPattern(const GenoData &genos, int start = 0);
@@ -33,8 +31,6 @@ public:
 	double frequency() const { return m_frequency; }
 	double prefix_freq() const { return m_prefix_freq; }
 	double transition_prob() const { return m_transition_prob; }
-	const HaploPattern *successors(int i) const { return i < m_successors.size() ? m_successors[i] : 0; }
-	const HaploPattern *successors(Allele &a) const { return successors(m_genos.getAlleleIndex(m_end, a)); }
 
 	int getAlleleIndex(int local_locus) const;
 	int getGlobalLocus(int local_locus) const { return m_start+local_locus; }
@@ -45,7 +41,6 @@ public:
 	void setFrequency(double f) { m_frequency = f; }
 	void setPrefixFreq(double f) { m_prefix_freq = f; }
 	void setTransitionProb(double p) { m_transition_prob = p < 1.0 ? p : 1.0; }
-	void setSuccessor(size_t i, const HaploPattern *pn);
 
 	void repack();
 
@@ -69,8 +64,9 @@ public:
 	using NoThrowNewDelete::operator new;
 	using NoThrowNewDelete::operator delete;
 
-	static void *operator new(std::size_t) { return m_pool.malloc(); }
-	static void operator delete(void *pMemory) { m_pool.free(pMemory); }
+	// singleton_pool is locked, so patterns may be created by worker threads
+	static void *operator new(std::size_t) { return boost::singleton_pool<HaploPattern, sizeof(HaploPattern)>::malloc(); }
+	static void operator delete(void *pMemory) { boost::singleton_pool<HaploPattern, sizeof(HaploPattern)>::free(pMemory); }
 
 	struct greater_frequency {
 		bool operator()(const HaploPattern *hp1, const HaploPattern *hp2) const
@@ -91,12 +87,6 @@ inline HaploPattern::HaploPattern(const GenoData &genos, int start)
 {
 }
 
-inline void HaploPattern::setSuccessor(size_t i, const HaploPattern *pn)
-{
-	m_successors.resize(i+1); // if (i < m_successors.size()) resize do nothing
-	m_successors[i] = pn;
-}
-
 inline bool HaploPattern::isMatch(const Haplotype &h) const
 {
 	return h.isMatch(*this, m_start, 0, length());
@@ -0,0 +1,399 @@
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include "ModelFile.h"
+#include "HaploPattern.h"
+#include "PatternManager.h"
+
+#include "MemLeak.h"
+
+
+////////////////////////////////
+//
+// class BinaryWriter
+
+class BinaryWriter {
+	FILE *m_fp;
+	string m_filename;
+
+public:
+	explicit BinaryWriter(const string &filename);
+	~BinaryWriter();
+
+	void put(const void *data, int size);
+	void putChar(char c) { put(&c, sizeof(c)); }
+	void putShort(unsigned short s) { put(&s, sizeof(s)); }
+	void putInt(int i) { put(&i, sizeof(i)); }
+	void putDouble(double d) { put(&d, sizeof(d)); }
+	void putString(const string &s);
+};
+
+BinaryWriter::BinaryWriter(const string &filename)
+: m_filename(filename)
+{
+	m_fp = fopen(filename.c_str(), "wb");
+	if (m_fp == NULL) {
+		Logger::error("Can not open file %s!", filename.c_str());
+		exit(1);
+	}
+}
+
+BinaryWriter::~BinaryWriter()
+{
+	if (fclose(m_fp) != 0) {
+		Logger::error("Can not write file %s!", m_filename.c_str());
+		exit(1);
+	}
+}
+
+void BinaryWriter::put(const void *data, int size)
+{
+	if (fwrite(data, 1, size, m_fp) != size) {
+		Logger::error("Can not write file %s!", m_filename.c_str());
+		exit(1);
+	}
+}
+
+void BinaryWriter::putString(const string &s)
+{
+	putInt(s.size());
+	put(s.data(), s.size());
+}
+
+
+////////////////////////////////
+//
+// class BinaryReader
+
+// Reads a file from a read-only memory mapping, checking that every
+// value is within the file.
+
+class BinaryReader {
+	boost::iostreams::mapped_file_source m_file;
+	string m_filename;
+	const char *m_pos, *m_end;
+
+public:
+	explicit BinaryReader(const string &filename);
+
+	void get(void *data, int size);
+	char getChar() { char c; get(&c, sizeof(c)); return c; }
+	unsigned short getShort() { unsigned short s; get(&s, sizeof(s)); return s; }
+	int getInt() { int i; get(&i, sizeof(i)); return i; }
+	double getDouble() { double d; get(&d, sizeof(d)); return d; }
+	string getString();
+
+	void fail(const char *reason);
+};
+
+BinaryReader::BinaryReader(const string &filename)
+: m_filename(filename),
+  m_pos(0),
+  m_end(0)
+{
+	FILE *fp = fopen(filename.c_str(), "rb");
+	if (fp == NULL) {
+		Logger::error("Can not open file %s!", filename.c_str());
+		exit(1);
+	}
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fclose(fp);
+	if (size > 0) {								// empty files can not be mapped
+		try {
+			m_file.open(filename);
+		}
+		catch (std::exception &) {
+			Logger::error("Can not map file %s!", filename.c_str());
+			exit(1);
+		}
+		m_pos = m_file.data();
+		m_end = m_pos + m_file.size();
+	}
+}
+
+void BinaryReader::get(void *data, int size)
+{
+	if (m_end - m_pos < size) fail("is truncated");
+	memcpy(data, m_pos, size);
+	m_pos += size;
+}
+
+string BinaryReader::getString()
+{
+	int n = getInt();
+	if (n < 0 || m_end - m_pos < n) fail("is truncated");
+	string s(m_pos, n);
+	m_pos += n;
+	return s;
+}
+
+void BinaryReader::fail(const char *reason)
+{
+	Logger::error("Model file %s %s!", m_filename.c_str(), reason);
+	exit(1);
+}
+
+
+////////////////////////////////
+//
+// class ModelFile
+
+const char ModelFile::m_magic[4] = { 'H', 'M', 'C', 'M' };
+const char ModelFile::m_checkpoint_magic[4] = { 'H', 'M', 'C', 'C' };
+const int ModelFile::m_version = 1;
+
+void ModelFile::write(const HaploBuilder &hb)
+{
+	BinaryWriter out(m_filename);
+	writeHeader(out, m_magic);
+	writePatterns(out, hb);
+}
+
+// genos receives the allele tables of the model, which its patterns refer to
+void ModelFile::read(HaploBuilder &hb, GenoData &genos)
+{
+	BinaryReader in(m_filename);
+	readHeader(in, m_magic);
+	readPatterns(in, hb, genos, true);
+}
+
+void ModelFile::writeCheckpoint(const HaploBuilder &hb, const GenoData &resolutions, int iteration, double log_likelihood)
+{
+	const GenoData &genos = *hb.genos();
+	const HaploData &samples = *hb.samples();
+	int i, width;
+	string temp_file = m_filename + ".tmp";
+	{
+		BinaryWriter out(temp_file);
+		writeHeader(out, m_checkpoint_magic);
+		out.putInt(iteration);
+		out.putDouble(log_likelihood);
+		writePatterns(out, hb);
+		width = hb.pattern_manager().m_successor_stride < 256 ? 1 : 2;
+		out.putInt(width);
+		out.putInt(samples.haplotype_num());
+		for (i=0; i<samples.haplotype_num(); ++i) {
+			out.putDouble(samples.weight(i));
+			writeAlleles(out, genos, samples[i], width);
+		}
+		out.putInt(resolutions.genotype_num());
+		for (i=0; i<resolutions.genotype_num(); ++i) {
+			const Genotype &g = resolutions[i];
+			out.putString(g.id());
+			out.putChar(g.isPhased());
+			out.putDouble(g.log_genotype_probability());
+			writeAlleles(out, genos, g(0), width);
+			writeAlleles(out, genos, g(1), width);
+		}
+	}
+	if (rename(temp_file.c_str(), m_filename.c_str()) != 0
+		&& (remove(m_filename.c_str()) != 0 || rename(temp_file.c_str(), m_filename.c_str()) != 0)) {	// not replaced on Windows
+		Logger::error("Can not write file %s!", m_filename.c_str());
+		exit(1);
+	}
+}
+
+// genos must be the genotypes the checkpointed run learned from
+void ModelFile::readCheckpoint(HaploBuilder &hb, GenoData &genos, GenoData &resolutions, int &iteration, double &log_likelihood)
+{
+	HaploData &samples = *hb.samples();
+	int i, n, width;
+	BinaryReader in(m_filename);
+	readHeader(in, m_checkpoint_magic);
+	iteration = in.getInt();
+	log_likelihood = in.getDouble();
+	readPatterns(in, hb, genos, false);
+	width = in.getInt();
+	if (width != 1 && width != 2) in.fail("is corrupted");
+	n = in.getInt();
+	if (n < 0) in.fail("is corrupted");
+	samples.clear();
+	Haplotype h(genos.genotype_len());
+	for (i=0; i<n; ++i) {
+		h.setWeight(in.getDouble());
+		readAlleles(in, genos, h, width);
+		samples.addHaplotype(h);
+	}
+	samples.checkTotalWeight();
+	if (in.getInt() != genos.genotype_num()) in.fail("does not match the genotypes");
+	resolutions = genos;
+	for (i=0; i<genos.genotype_num(); ++i) {
+		Genotype &g = resolutions[i];
+		g.setID(in.getString());
+		g.setIsPhased(in.getChar() != 0);
+		g.setLogGenotypeProbability(in.getDouble());
+		readAlleles(in, genos, g(0), width);
+		readAlleles(in, genos, g(1), width);
+		g.checkGenotype();
+	}
+}
+
+void ModelFile::writeHeader(BinaryWriter &out, const char *magic)
+{
+	out.put(magic, 4);
+	out.putInt(m_version);
+	out.putInt(0x01020304);
+}
+
+void ModelFile::readHeader(BinaryReader &in, const char *magic)
+{
+	char buf[4];
+	in.get(buf, sizeof(buf));
+	if (memcmp(buf, magic, sizeof(buf)) != 0) {
+		in.fail(magic == m_magic ? "is not a model file" : "is not a checkpoint file");
+	}
+	if (in.getInt() != m_version) in.fail("has an unsupported version");
+	if (in.getInt() != 0x01020304) in.fail("was written with another byte order");
+}
+
+void ModelFile::writePatterns(BinaryWriter &out, const HaploBuilder &hb)
+{
+	const GenoData &genos = *hb.genos();
+	const PatternManager &pm = hb.m_patterns;
+	int i, j, k, n, len, stride, width;
+	len = genos.genotype_len();
+	n = pm.size();
+	stride = pm.m_successor_stride;
+	width = stride <= 256 ? 1 : 2;
+	out.putInt(len);
+	out.putInt(n);
+	out.putInt(stride);
+	out.putInt(width);
+	for (k=0; k<len; ++k) {
+		out.putChar(genos.allele_type(k));
+		out.putInt(genos.allele_postition(k));
+		out.putString(genos.allele_name(k));
+		out.putInt(pm.m_min_len[k]);
+		out.putInt(pm.m_max_len[k]);
+		out.putInt(genos.allele_num(k));
+		for (j=0; j<genos.allele_num(k); ++j) {
+			out.putInt(genos.allele_symbol(k, j).asInt());
+			out.putDouble(genos.allele_frequency(k, j));
+		}
+	}
+	for (i=0; i<n; ++i) {
+		const HaploPattern *hp = pm[i];
+		out.putInt(hp->start());
+		out.putInt(hp->length());
+		out.putDouble(hp->frequency());
+		out.putDouble(hp->prefix_freq());
+		out.putDouble(hp->transition_prob());
+		for (j=0; j<hp->length(); ++j) {
+			if (width == 1) {
+				out.putChar(hp->getAlleleIndex(j));
+			}
+			else {
+				out.putShort(hp->getAlleleIndex(j));
+			}
+		}
+	}
+	for (i=0; i<n*stride; ++i) {
+		out.putInt(pm.m_successors[i].pattern);
+	}
+}
+
+// With tables set, genos receives the allele tables of the file; otherwise
+// they must be those of genos already.
+void ModelFile::readPatterns(BinaryReader &in, HaploBuilder &hb, GenoData &genos, bool tables)
+{
+	PatternManager &pm = hb.m_patterns;
+	int i, j, k, n, len, stride, width, start, num;
+	len = in.getInt();
+	n = in.getInt();
+	stride = in.getInt();
+	width = in.getInt();
+	if (len <= 0 || n < 0 || stride <= 0 || (width != 1 && width != 2)) in.fail("is corrupted");
+	if (!tables && len != genos.genotype_len()) in.fail("does not match the genotypes");
+
+	if (tables) {
+		genos = GenoData();
+		genos.setGenotypeLen(len);
+	}
+	pm.m_min_len.resize(len);
+	pm.m_max_len.resize(len);
+	for (k=0; k<len; ++k) {
+		char type = in.getChar();
+		int position = in.getInt();
+		string name = in.getString();
+		if (tables) {
+			genos.setAlleleType(k, type);
+			genos.setAllelePosition(k, position);
+			genos.setAlleleName(k, name);
+		}
+		pm.m_min_len[k] = in.getInt();
+		pm.m_max_len[k] = in.getInt();
+		num = in.getInt();
+		if (num < 0 || num > stride) in.fail("is corrupted");
+		if (!tables && num != genos.allele_num(k)) in.fail("does not match the genotypes");
+		for (j=0; j<num; ++j) {
+			Allele a(in.getInt());
+			double freq = in.getDouble();
+			if (tables) {
+				genos.m_allele_symbol[k].push_back(make_pair(a, freq));
+				genos.m_allele_index[k].set(a, j);
+			}
+			else if (genos.allele_symbol(k, j) != a) {
+				in.fail("does not match the genotypes");
+			}
+		}
+	}
+	hb.setGenoData(genos);
+
+	DeleteAll_Clear()(pm.m_patterns);
+	for (i=0; i<n; ++i) {
+		start = in.getInt();
+		num = in.getInt();
+		if (start < 0 || num <= 0 || start + num > len) in.fail("is corrupted");
+		HaploPattern *hp = new HaploPattern(genos, start);
+		pm.m_patterns.push_back(hp);
+		hp->setFrequency(in.getDouble());
+		hp->setPrefixFreq(in.getDouble());
+		hp->setTransitionProb(in.getDouble());
+		for (j=0; j<num; ++j) {
+			k = width == 1 ? (unsigned char) in.getChar() : in.getShort();
+			if (k >= genos.allele_num(start+j)) in.fail("is corrupted");
+			(*hp) += genos.allele_symbol(start+j, k);
+		}
+	}
+	pm.m_successor_stride = stride;
+	pm.m_successors.assign(n * stride, PatternSuccessor());
+	for (i=0; i<n*stride; ++i) {
+		k = in.getInt();
+		if (k < -1 || k >= n) in.fail("is corrupted");
+		pm.m_successors[i].pattern = k;
+	}
+	pm.buildPatternTree();
+	pm.updateSuccessors();
+}
+
+void ModelFile::writeAlleles(BinaryWriter &out, const GenoData &genos, const Haplotype &h, int width)
+{
+	for (int k=0; k<genos.genotype_len(); ++k) {
+		int a = genos.getAlleleIndex(k, h[k]);
+		if (width == 1) {
+			out.putChar(a);
+		}
+		else {
+			out.putShort(a);
+		}
+	}
+}
+
+void ModelFile::readAlleles(BinaryReader &in, const GenoData &genos, Haplotype &h, int width)
+{
+	int k, a, missing;
+	missing = width == 1 ? 0xFF : 0xFFFF;
+	h.setLength(genos.genotype_len());
+	for (k=0; k<genos.genotype_len(); ++k) {
+		a = width == 1 ? (unsigned char) in.getChar() : in.getShort();
+		if (a == missing) {
+			h[k] = Allele();
+		}
+		else if (a < genos.allele_num(k)) {
+			h[k] = genos.allele_symbol(k, a);
+		}
+		else {
+			in.fail("is corrupted");
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef __MODELFILE_H
+#define __MODELFILE_H
+
+
+#include <string>
+
+#include "Utils.h"
+#include "GenoData.h"
+#include "HaploBuilder.h"
+
+
+class BinaryWriter;
+class BinaryReader;
+
+
+// A learned model in binary form: the allele tables of the markers, the
+// patterns with their frequencies and transition probabilities, and the
+// successor table, so that new genotypes can be phased against it without
+// searching patterns again.  Numbers are stored in the byte order of the
+// machine that wrote the file; the header tells if it can not be read.
+//
+//   header    "HMCM", version, byte order mark 0x01020304, marker number,
+//             pattern number, successor stride, pattern allele width
+//   markers   type, position, name, minimum and maximum pattern length,
+//             allele number, and the symbol and frequency of each allele
+//   patterns  start, length, frequency, prefix frequency, transition
+//             probability and the allele indexes
+//   successor pattern number * stride successor ids (-1 for none)
+//
+// A checkpoint of a learning run starts with "HMCC", version, byte order
+// mark, the number of finished iterations and their best log-likelihood,
+// continues with the sections above for the patterns to resolve with next,
+// and ends with the state of the run, alleles stored as indexes (all bits
+// set for missing ones):
+//   samples      haplotype number, then the weight and alleles of each
+//   resolutions  genotype number, then the id, phased flag, log genotype
+//                probability and the alleles of both haplotypes of each
+// It is written to a temporary file first, so a run killed while writing
+// keeps the previous checkpoint.
+
+class ModelFile {
+protected:
+	string m_filename;
+
+	static const char m_magic[4];
+	static const char m_checkpoint_magic[4];
+	static const int m_version;
+
+public:
+	explicit ModelFile(const string &filename) : m_filename(filename) { }
+
+	const string &filename() const { return m_filename; }
+
+	void write(const HaploBuilder &hb);
+	void read(HaploBuilder &hb, GenoData &genos);
+
+	void writeCheckpoint(const HaploBuilder &hb, const GenoData &resolutions, int iteration, double log_likelihood);
+	void readCheckpoint(HaploBuilder &hb, GenoData &genos, GenoData &resolutions, int &iteration, double &log_likelihood);
+
+protected:
+	static void writeHeader(BinaryWriter &out, const char *magic);
+	static void readHeader(BinaryReader &in, const char *magic);
+	static void writePatterns(BinaryWriter &out, const HaploBuilder &hb);
+	static void readPatterns(BinaryReader &in, HaploBuilder &hb, GenoData &genos, bool tables);
+	static void writeAlleles(BinaryWriter &out, const GenoData &genos, const Haplotype &h, int width);
+	static void readAlleles(BinaryReader &in, const GenoData &genos, Haplotype &h, int width);
+};
+
+
+#endif // __MODELFILE_H
@@ -0,0 +1,56 @@
+#ifndef __PARALLEL_H
+#define __PARALLEL_H
+
+
+#include <vector>
+#include <boost/ref.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "Utils.h"
+
+
+class WorkQueue {
+	boost::mutex m_mutex;
+	int m_next, m_size;
+
+public:
+	explicit WorkQueue(int size) : m_next(0), m_size(size) { }
+
+	bool fetch(int &i);
+
+private:
+	WorkQueue(const WorkQueue &);
+	WorkQueue &operator=(const WorkQueue &);
+};
+
+inline bool WorkQueue::fetch(int &i)
+{
+	boost::mutex::scoped_lock lock(m_mutex);
+	if (m_next < m_size) {
+		i = m_next++;
+		return true;
+	}
+	return false;
+}
+
+
+// run every worker in its own thread (the calling thread if only one)
+
+template <class T>
+void run_parallel(vector<T*> &workers)
+{
+	if (workers.size() == 1) {
+		(*workers[0])();
+	}
+	else {
+		boost::thread_group threads;
+		for (int i=0; i<workers.size(); ++i) {
+			threads.create_thread(boost::ref(*workers[i]));
+		}
+		threads.join_all();
+	}
+}
+
+
+#endif // __PARALLEL_H
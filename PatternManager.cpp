@@ -6,11 +6,13 @@
 #include "Genotype.h"
 #include "HaploPattern.h"
 #include "HaploBuilder.h"
+#include "Parallel.h"
 
 
 PatternManager::~PatternManager()
 {
 	DeleteAll_Clear()(m_patterns);
+	DeleteAll_Clear()(m_previous);
 	DeleteAll_Clear()(m_candidates);
 }
 
@@ -32,44 +34,75 @@ void PatternManager::findPatternByFreq(double min_freq, int min_len, int max_len
 	max_len = max(max_len, min_len);
 	m_min_len.resize(geno_len, min_len);
 	m_max_len.resize(geno_len, max_len);
-	DeleteAll_Clear()(m_patterns);
+	m_previous.swap(m_patterns);
 	generateCandidates();
 	m_min_freq = min_freq;
 	searchPattern();
 	DeleteAll_Clear()(m_candidates);
 	Logger::verbose("Found haplotype patterns: %d     ", m_patterns.size());
-	initialize();
+	reinitialize();
 }
 
+// Best-first search: a pattern is never more frequent than its prefix,
+// so taking the candidates in descending frequency gives the max_num most
+// frequent patterns with all their prefixes, without rescanning.
 void PatternManager::findPatternByNum(int max_num, int min_len, int max_len)
 {
-	int last_size;
+	int i, n;
 	int geno_len = m_builder.genotype_len();
 	max_len = max_len <= 0 ? geno_len : max_len;
 	min_len = max(min_len, 1);
 	max_len = max(max_len, min_len);
 	m_min_len.resize(geno_len, min_len);
 	m_max_len.resize(geno_len, max_len);
-	DeleteAll_Clear()(m_patterns);
+	m_previous.swap(m_patterns);
 	generateCandidates();
+	vector<PatternCandidate*> children, heap;
+	int serial = 0;
+	// patterns up to the minimum length are always taken
+	while (!m_candidates.empty()) {
+		PatternCandidate *pc = m_candidates.back();
+		m_candidates.pop_back();
+		const HaploPattern *hp = pc->pattern;
+		if (hp->length() <= m_min_len[hp->start()]) {
+			extendCandidate(pc, children);
+			for (i=children.size()-1; i>=0; --i) {
+				m_candidates.push_back(children[i]);
+			}
+			if (hp->length() > 0 && hp->length() == m_min_len[hp->start()]) {
+				m_patterns.push_back(pc->release());
+			}
+			delete pc;
+		}
+		else {
+			pc->serial = serial++;
+			heap.push_back(pc);
+			push_heap(heap.begin(), heap.end(), PatternCandidate::less_frequency());
+		}
+	}
+	// then the most frequent ones, keeping those as frequent as all
 	m_min_freq = 1.0;
-	searchPattern(true);
-	max_num = max(max_num, m_patterns.size());
-	while (m_patterns.size() < max_num && m_min_freq > 1e-38) {
-		last_size = m_patterns.size();
-		m_min_freq *= 0.9;
-		searchPattern(true);
-	};
-	if (m_patterns.size() > max_num) {
-		vector<HaploPattern*>::iterator i_hp = m_patterns.begin() + last_size;
-		sort(i_hp, m_patterns.end(), HaploPattern::greater_frequency());
-		i_hp = m_patterns.begin() + max_num;
-		for_each(i_hp, m_patterns.end(), DeletePtr());
-		m_patterns.resize(max_num);
+	while (!heap.empty()) {
+		const HaploPattern *hp = heap.front()->pattern;
+		if (hp->frequency() < 1e-38 || (m_patterns.size() >= max_num && hp->frequency() < 1.0)) break;
+		pop_heap(heap.begin(), heap.end(), PatternCandidate::less_frequency());
+		PatternCandidate *pc = heap.back();
+		heap.pop_back();
+		extendCandidate(pc, children);
+		n = children.size();
+		for (i=0; i<n; ++i) {
+			children[i]->serial = serial++;
+			heap.push_back(children[i]);
+			push_heap(heap.begin(), heap.end(), PatternCandidate::less_frequency());
+		}
+		m_min_freq = min(m_min_freq, hp->frequency());
+		m_patterns.push_back(pc->release());
+		delete pc;
 	}
+	DeleteAll_Clear()(heap);
 	DeleteAll_Clear()(m_candidates);
 	Logger::verbose("Found haplotype patterns: %d     ", m_patterns.size());
-	initialize();
+	reinitialize();
 }
 
 void PatternManager::findPatternBlock(int len)
@@ -78,13 +111,13 @@ void PatternManager::findPatternBlock(int len)
 	len = max(1, len);
 	m_min_len.resize(geno_len, len);
 	m_max_len.resize(geno_len, len);
-	DeleteAll_Clear()(m_patterns);
+	m_previous.swap(m_patterns);
 	generateCandidates();
 	m_min_freq = -1.0;
 	searchPattern();
 	DeleteAll_Clear()(m_candidates);
 	Logger::verbose("Found haplotype patterns: %d     ", m_patterns.size());
-	initialize();
+	reinitialize();
 }
 
 void PatternManager::generateCandidates()
@@ -97,50 +130,93 @@ void PatternManager::generateCandidates()
 	}
 }
 
-void PatternManager::searchPattern(bool reserve_candidates)
+// searches the candidates of one start locus, independent of all others
+class PatternSearchWorker {
+	const PatternManager &m_manager;
+	WorkQueue &m_queue;
+	const vector<PatternManager::PatternCandidate*> &m_candidates;
+	vector<vector<HaploPattern*> > &m_patterns;
+
+public:
+	PatternSearchWorker(const PatternManager &pm, WorkQueue &queue, const vector<PatternManager::PatternCandidate*> &candidates,
+		vector<vector<HaploPattern*> > &patterns)
+		: m_manager(pm), m_queue(queue), m_candidates(candidates), m_patterns(patterns) { }
+
+	void operator()();
+};
+
+void PatternSearchWorker::operator()()
 {
-	int geno_len = m_builder.genotype_len();
-	const GenoData *genos = m_builder.genos();
-	PatternCandidate *pc_new = new PatternCandidate(m_builder.genos());
-	vector<PatternCandidate*> new_candidates;
-	while (!m_candidates.empty()) {
-		PatternCandidate *pc = m_candidates.back();
-		m_candidates.pop_back();
+	int k;
+	while (m_queue.fetch(k)) {
+		m_manager.searchPattern(m_candidates[k], m_patterns[k]);
+	}
+}
+
+void PatternManager::searchPattern()
+{
+	int i, n;
+	n = m_candidates.size();
+	vector<vector<HaploPattern*> > patterns(n);
+	WorkQueue queue(n);
+	vector<PatternSearchWorker*> workers;
+	for (i=0; i<max(m_builder.thread_num, 1); ++i) {
+		workers.push_back(new PatternSearchWorker(*this, queue, m_candidates, patterns));
+	}
+	run_parallel(workers);
+	DeleteAll_Clear()(workers);
+	m_candidates.clear();
+	for (i=n-1; i>=0; --i) {						// same order as a single depth first search
+		m_patterns.insert(m_patterns.end(), patterns[i].begin(), patterns[i].end());
+	}
+}
+
+void PatternManager::searchPattern(PatternCandidate *pc, vector<HaploPattern*> &patterns) const
+{
+	vector<PatternCandidate*> candidates(1, pc), children;
+	while (!candidates.empty()) {
+		pc = candidates.back();
+		candidates.pop_back();
 		const HaploPattern *hp = pc->pattern;
 		if (hp->frequency() >= m_min_freq || hp->length() < m_min_len[hp->start()]) {
-			if (hp->end() < geno_len && hp->length() < m_max_len[hp->start()]) {
-				for (int i=0; i<genos->allele_num(hp->end()); ++i) {
-					if (genos->allele_frequency(hp->end(), i) > 0) {
-						HaploPattern *hp_new = pc_new->pattern;
-						hp_new->assign(*hp, genos->allele_symbol(hp->end(), i));
-						checkFrequencyWithExtension(hp_new, pc_new->state, pc->state, hp->end());
-						hp_new->setPrefixFreq(hp->frequency());
-						if (hp_new->prefix_freq() > 0) {
-							hp_new->setTransitionProb(hp_new->frequency() / hp_new->prefix_freq());
-						}
-						else {
-							hp_new->setTransitionProb(hp_new->frequency());
-						}
-						m_candidates.push_back(pc_new);
-						pc_new = new PatternCandidate(genos);
-					}
-				}
-			}
+			extendCandidate(pc, children);
+			candidates.insert(candidates.end(), children.begin(), children.end());
 		}
 		if (hp->frequency() >= m_min_freq || hp->length() <= m_min_len[hp->start()]) {
 			if (hp->length() > 0 && hp->length() >= m_min_len[hp->start()]) {
-				m_patterns.push_back(pc->release());
+				patterns.push_back(pc->release());
 			}
-			delete pc;
 		}
-		else if (reserve_candidates) {
-			new_candidates.push_back(pc);
-		}
-		else {
-			delete pc;
+		delete pc;
+	}
+}
+
+// the extensions of pc by one allele, unless it is at its maximum length
+void PatternManager::extendCandidate(const PatternCandidate *pc, vector<PatternCandidate*> &children) const
+{
+	int geno_len = m_builder.genotype_len();
+	const GenoData *genos = m_builder.genos();
+	const HaploPattern *hp = pc->pattern;
+	children.clear();
+	if (hp->end() < geno_len && hp->length() < m_max_len[hp->start()]) {
+		for (int i=0; i<genos->allele_num(hp->end()); ++i) {
+			if (genos->allele_frequency(hp->end(), i) > 0) {
+				PatternCandidate *pc_new = new PatternCandidate(genos);
+				HaploPattern *hp_new = pc_new->pattern;
+				hp_new->assign(*hp, genos->allele_symbol(hp->end(), i));
+				pc_new->previous = findPrevious(pc, hp_new, i);
+				checkFrequencyWithExtension(hp_new, pc_new->state, pc->state, hp->end());
+				hp_new->setPrefixFreq(hp->frequency());
+				if (hp_new->prefix_freq() > 0) {
+					hp_new->setTransitionProb(hp_new->frequency() / hp_new->prefix_freq());
+				}
+				else {
+					hp_new->setTransitionProb(hp_new->frequency());
+				}
+				children.push_back(pc_new);
+			}
 		}
 	}
-	m_candidates.swap(new_candidates);
 }
 
 void PatternManager::checkFrequency(HaploPattern *hp, MatchingState &ms) const
@@ -167,26 +243,23 @@ void PatternManager::checkFrequency(HaploPattern *hp, MatchingState &ms) const
 						freq += 2.0;
 						total_freq += 0.5;
 					}
-					if (freq > 0.5) ms.push_back(make_pair(i, freq));
+					if (freq > 0.5) ms.genotypes.push_back(make_pair(i, freq));
 				}
 				else if (hp->isMatch(g)) {
 					freq = getMatchingFrequency(g, &(*hp)[0], hp->start(), hp->length());
 					total_freq += freq;
-					ms.push_back(make_pair(i, freq));
+					ms.genotypes.push_back(make_pair(i, freq));
 				}
 			}
 			hp->setFrequency(total_freq / geno_num);
 		}
 		else {
 			const HaploData &haplos = *m_builder.samples();
-			int haplo_num = haplos.haplotype_num();
-			for (int i=0; i<haplo_num; ++i) {
-				const Haplotype &h = haplos[i];
-				if (hp->isMatch(h)) {
-					total_freq += h.weight();
-					ms.push_back(make_pair(i, 0));
-				}
+			haplos.matchAll(ms.haplotypes);
+			for (int i=0; i<hp->length(); ++i) {
+				haplos.match(ms.haplotypes, hp->start()+i, (*hp)[i]);
 			}
+			total_freq = haplos.getWeight(ms.haplotypes);
 			hp->setFrequency(total_freq / haplos.total_weight());
 		}
 	}
@@ -201,10 +274,10 @@ void PatternManager::checkFrequencyWithExtension(HaploPattern *hp, MatchingState
 	{
 		ms.clear();
 		double total_freq = 0;
-		MatchingState::const_iterator i_ms = oms.begin();
+		list<pair<int, double> >::const_iterator i_ms = oms.genotypes.begin();
 		if (m_builder.samples()->empty()) {
 			const GenoData &genos = *m_builder.genos();
-			while (i_ms != oms.end()) {
+			while (i_ms != oms.genotypes.end()) {
 				const Genotype &g = genos[i_ms->first];
 				double freq = i_ms->second;
 				if (g.isPhased()) {
@@ -238,12 +311,12 @@ void PatternManager::checkFrequencyWithExtension(HaploPattern *hp, MatchingState
 							freq -= 1.0;
 						}
 					}
-					if (freq > 0.5) ms.push_back(make_pair(i_ms->first, freq));
+					if (freq > 0.5) ms.genotypes.push_back(make_pair(i_ms->first, freq));
 				}
 				else if (hp->isMatch(g, start, len)) {
 					freq *= getMatchingFrequency(g, &(*hp)[start-hp->start()], start, len);
 					total_freq += freq;
-					ms.push_back(make_pair(i_ms->first, freq));
+					ms.genotypes.push_back(make_pair(i_ms->first, freq));
 				}
 				++i_ms;
 			}
@@ -251,14 +324,11 @@ void PatternManager::checkFrequencyWithExtension(HaploPattern *hp, MatchingState
 		}
 		else {
 			const HaploData &haplos = *m_builder.samples();
-			while (i_ms != oms.end()) {
-				const Haplotype &h = haplos[i_ms->first];
-				if (hp->isMatch(h, start, len)) {
-					total_freq += h.weight();
-					ms.push_back(make_pair(i_ms->first, 0));
-				}
-				++i_ms;
+			ms.haplotypes = oms.haplotypes;
+			for (int i=0; i<len; ++i) {
+				haplos.match(ms.haplotypes, start+i, (*hp)[start-hp->start()+i]);
 			}
+			total_freq = haplos.getWeight(ms.haplotypes);
 			hp->setFrequency(total_freq / haplos.total_weight());
 		}
 	}
@@ -292,8 +362,102 @@ double PatternManager::getMatchingFrequency(const Genotype &g, const Allele *pa,
 
 void PatternManager::initialize()
 {
-	int i, j, n;
-	AlleleSequence temp;
+	int i, n;
+	buildPatternTree();
+	n = m_patterns.size();
+	m_successor_stride = m_builder.genos()->max_allele_num();
+	m_successors.assign(n * m_successor_stride, PatternSuccessor());
+	for (i=0; i<n; ++i) {
+		findSuccessors(i);
+	}
+	updateSuccessors();
+}
+
+// Warm start from the patterns of the previous search, which the search
+// has matched to the new ones (see findPrevious()).  The successors of
+// the patterns found again are carried over, and only the successors that
+// a pattern added or dropped since then can change are looked up again.
+// The result is the same as initialize().
+void PatternManager::reinitialize()
+{
+	int i, j, k, n, m;
+	n = m_patterns.size();
+	m = m_previous.size();
+	if (m == 0 || !m_pattern_tree || m_successors.size() != m * m_successor_stride) {
+		DeleteAll_Clear()(m_previous);
+		initialize();
+		return;
+	}
+	vector<int> old_id(n, -1);
+	vector<int> new_id(m, -1);
+	vector<HaploPattern*> changed;
+	for (i=0; i<n; ++i) {
+		old_id[i] = (int) m_patterns[i]->id();
+		if (old_id[i] >= 0) {
+			new_id[old_id[i]] = i;
+		}
+		else {
+			changed.push_back(m_patterns[i]);				// added
+		}
+	}
+	for (j=0; j<m; ++j) {
+		if (new_id[j] < 0) changed.push_back(m_previous[j]);	// dropped
+	}
+	if (changed.size() > n / 8) {							// cheaper to start over
+		DeleteAll_Clear()(m_previous);
+		initialize();
+		return;
+	}
+	buildPatternTree();
+	vector<PatternSuccessor> successors(n * m_successor_stride, PatternSuccessor());
+	m_successors.swap(successors);
+	for (i=0; i<n; ++i) {
+		if (old_id[i] < 0) {
+			findSuccessors(i);
+		}
+		else {
+			for (j=0; j<m_successor_stride; ++j) {
+				k = successors[old_id[i]*m_successor_stride+j].pattern;
+				m_successors[i*m_successor_stride+j].pattern = k < 0 ? -1 : new_id[k];
+			}
+		}
+	}
+	// a changed pattern can only be the successor of the patterns ending
+	// just before it that share the rest of its alleles
+	vector<HaploPattern*> affected;
+	m = changed.size();
+	for (i=0; i<m; ++i) {
+		HaploPattern *hp = changed[i];
+		if (hp->end() < 2) continue;
+		m_pattern_tree->findSuffixPatterns(hp->end()-1, hp, hp->start(), hp->length()-1, affected);
+		k = hp->getAlleleIndex(hp->length()-1);
+		for (j=0; j<affected.size(); ++j) {
+			findSuccessors(affected[j]->id(), k);
+		}
+	}
+	updateSuccessors();
+	DeleteAll_Clear()(m_previous);
+}
+
+// id of the pattern of the previous search equal to hp, the child of pc
+// with allele index allele, or -1 if there is none
+int PatternManager::findPrevious(const PatternCandidate *pc, const HaploPattern *hp, int allele) const
+{
+	if (m_previous.empty() || !m_pattern_tree) return -1;
+	if (hp->length() <= m_min_len[hp->start()]) {
+		const HaploPattern *old = m_pattern_tree->findLongestMatchPattern(hp->end(), hp);
+		return old && old->start() == hp->start() ? (int) old->id() : -1;
+	}
+	if (pc->previous < 0) return -1;
+	// the old successor is the longest old pattern matching hp, so it is
+	// hp itself if it starts at the same locus
+	int succ = successor(pc->previous, allele).pattern;
+	return succ >= 0 && m_previous[succ]->start() == hp->start() ? succ : -1;
+}
+
+void PatternManager::buildPatternTree()
+{
+	int i, n;
 	m_pattern_tree.reset(new BackwardPatternTree(*m_builder.genos()));
 	m_head_list.clear();
 	n = m_patterns.size();
@@ -305,14 +469,35 @@ void PatternManager::initialize()
 			m_head_list.push_back(hp);
 		}
 	}
+	m_pattern_tree->compile();
+}
+
+// look up the successors of pattern i for allele index allele, or all alleles if it is negative
+void PatternManager::findSuccessors(int i, int allele)
+{
+	int j, n;
+	AlleleSequence temp;
+	HaploPattern *hp = m_patterns[i];
+	if (hp->end() >= m_builder.genotype_len()) return;
+	temp.assign(*hp, Allele());			// append empty allele
+	n = m_builder.genos()->allele_num(hp->end());
+	for (j=0; j<n; ++j) {
+		if (allele >= 0 && j != allele) continue;
+		temp[temp.length()-1] = m_builder.genos()->allele_symbol(hp->end(), j);
+		HaploPattern *succ = m_pattern_tree->findLongestMatchPattern(hp->end()+1, &temp, hp->start());
+		m_successors[i*m_successor_stride+j].pattern = succ ? succ->id() : -1;
+	}
+}
+
+// copy the transition probabilities of the patterns into the successor table
+void PatternManager::updateSuccessors()
+{
+	int i, n;
+	n = m_successors.size();
 	for (i=0; i<n; ++i) {
-		HaploPattern *hp = m_patterns[i];
-		if (hp->end() < m_builder.genotype_len()) {
-			temp.assign(*hp, Allele());			// append empty allele
-			for (j=0; j<m_builder.genos()->allele_num(hp->end()); ++j) {
-				temp[temp.length()-1] = m_builder.genos()->allele_symbol(hp->end(), j);
-				hp->setSuccessor(j, m_pattern_tree->findLongestMatchPattern(hp->end()+1, &temp, hp->start()));
-			}
+		PatternSuccessor &ps = m_successors[i];
+		if (ps.pattern >= 0) {
+			ps.transition_prob = m_patterns[ps.pattern]->transition_prob();
 		}
 	}
 }
@@ -359,6 +544,7 @@ void PatternManager::estimateFrequency()
 		m_patterns[i]->setTransitionProb(patterns[i]->transition_prob());
 	}
 	DeleteAll_Clear()(patterns);
+	updateSuccessors();
 }
 
 void PatternManager::estimatePatterns()
@@ -377,8 +563,8 @@ void PatternManager::estimatePatterns()
 			if (hp->end() < geno_len && hp->length() < m_max_len[hp->start()]) {
 				int an = m_builder.genos()->allele_num(hp->end());
 				for (j=0; j<an; ++j) {
-					const HaploPattern *succ = hp->successors(j);
-					if (!succ || succ->start() != hp->start()) {
+					int succ = successor(i, j).pattern;
+					if (succ < 0 || m_patterns[succ]->start() != hp->start()) {
 						HaploPattern *hp_new = new HaploPattern(*m_builder.genos());
 						hp_new->assign(*hp, m_builder.genos()->allele_symbol(hp->end(), j));
 						patterns.push_back(hp_new);
@@ -15,26 +15,59 @@ class Genotype;
 class HaploBuilder;
 
 
+// the pattern following a pattern with one more allele
+struct PatternSuccessor {
+	int pattern;								// id of the successor, -1 if none
+	double transition_prob;						// transition probability of the successor
+
+	PatternSuccessor() : pattern(-1), transition_prob(0) { }
+};
+
+
 class PatternManager {
-	typedef list<pair<int, double> > MatchingState;
+	friend class PatternSearchWorker;
+	friend class ModelFile;
+
+	struct MatchingState {
+		list<pair<int, double> > genotypes;		// matched genotypes and matching frequencies
+		vector<unsigned int> haplotypes;		// bitset of matched sample haplotypes
+
+		void clear() { genotypes.clear(); haplotypes.clear(); }
+		bool empty() const { return genotypes.empty() && haplotypes.empty(); }
+	};
 
 	struct PatternCandidate {
 		HaploPattern *pattern;
 		MatchingState state;
+		int serial;								// creation order, breaks frequency ties
+		int previous;							// id of the same pattern in the previous search, or -1
 
 		PatternCandidate(const GenoData *genos, int start = 0)
-			: pattern(new HaploPattern(*genos, start)) { }
+			: pattern(new HaploPattern(*genos, start)), serial(0), previous(-1) { }
 		~PatternCandidate() { delete pattern; }
 		HaploPattern *release() {
 			HaploPattern *hp = pattern;
+			hp->setID(previous);				// until the pattern tree is rebuilt
 			pattern = 0;
 			state.clear();
 			return hp; 
 		}
+
+		// heap order, the most frequent and then the earliest on top
+		struct less_frequency {
+			bool operator()(const PatternCandidate *pc1, const PatternCandidate *pc2) const
+			{
+				if (pc1->pattern->frequency() != pc2->pattern->frequency()) {
+					return pc1->pattern->frequency() < pc2->pattern->frequency();
+				}
+				return pc1->serial > pc2->serial;
+			}
+		};
 	};
 
 	HaploBuilder &m_builder;
 	vector<HaploPattern*> m_patterns;
+	vector<HaploPattern*> m_previous;			// patterns of the previous search, while searching
 	vector<PatternCandidate*> m_candidates;
 	double m_min_freq;
 	vector<int> m_min_len;
@@ -43,8 +76,11 @@ class PatternManager {
 	tr1::shared_ptr<BackwardPatternTree> m_pattern_tree;
 	vector<HaploPattern*> m_head_list;
 
+	vector<PatternSuccessor> m_successors;		// m_successor_stride entries per pattern id
+	int m_successor_stride;
+
 public:
-	PatternManager(HaploBuilder &hb) : m_builder(hb) { }
+	PatternManager(HaploBuilder &hb) : m_builder(hb), m_successor_stride(0) { }
 	~PatternManager();
 
 	HaploPattern *operator [](int i) { return m_patterns[i]; }
@@ -53,6 +89,9 @@ public:
 	const vector<HaploPattern*> &head_list() const { return m_head_list; }
 	int head_len() const { return m_min_len[0]; }
 
+	// successor of pattern id extended by allele index allele of its end locus
+	const PatternSuccessor &successor(int id, int allele) const { return m_successors[id*m_successor_stride+allele]; }
+
 	int size() const { return m_patterns.size(); }
 
 	HaploPattern *getSingleAllelePattern(int end, int index) const;
@@ -68,13 +107,20 @@ public:
 
 protected:
 	void generateCandidates();
-	void searchPattern(bool reserve_candidates = false);
+	void searchPattern();
+	void searchPattern(PatternCandidate *pc, vector<HaploPattern*> &patterns) const;
+	void extendCandidate(const PatternCandidate *pc, vector<PatternCandidate*> &children) const;
 
 	void checkFrequency(HaploPattern *hp, MatchingState &ms) const;
 	void checkFrequencyWithExtension(HaploPattern *hp, MatchingState &ms, const MatchingState &old_ms, int start, int len = 1) const;
 	double getMatchingFrequency(const Genotype &g, const Allele *pa, int start, int len) const;
 
 	void initialize();
+	void reinitialize();
+	int findPrevious(const PatternCandidate *pc, const HaploPattern *hp, int allele) const;
+	void buildPatternTree();
+	void findSuccessors(int i, int allele = -1);
+	void updateSuccessors();
 	void extendPatterns(vector<HaploPattern*> &patterns, vector<HaploPattern*> &seeds);
 };
 
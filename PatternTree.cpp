@@ -6,8 +6,6 @@
 #include "MemLeak.h"
 
 
-boost::pool<> PatternNode::m_pool(sizeof(PatternNode));
-
 ////////////////////////////////
 //
 // class BackwardPatternTree
@@ -47,6 +45,48 @@ void BackwardPatternTree::addPattern(PatternNode *node, HaploPattern *hp, int le
 	}
 }
 
+void BackwardPatternTree::compile()
+{
+	int i, n;
+	n = m_trees.size();
+	m_roots.resize(n);
+	m_data.clear();
+	m_child_start.clear();
+	m_children.clear();
+	m_subtree_end.clear();
+	for (i=0; i<n; ++i) {
+		m_roots[i] = compile(&m_trees[i], i-1);
+	}
+	m_trees.clear();
+}
+
+// append node and its subtree in preorder, children of node match locus
+int BackwardPatternTree::compile(const PatternNode *node, int locus)
+{
+	int i, n, k, start, j;
+	k = m_data.size();
+	m_data.push_back(node->data());
+	m_child_start.push_back(-1);
+	m_subtree_end.push_back(k+1);
+	if (locus < 0) return k;
+	n = min(node->size(), m_genos.allele_num(locus));
+	for (i=0; i<n; ++i) {
+		if (node->getChild(i)) break;
+	}
+	if (i == n) return k;
+	start = m_children.size();
+	m_child_start[k] = start;
+	m_children.resize(start + m_genos.allele_num(locus), -1);
+	for (i=0; i<n; ++i) {
+		if (node->getChild(i)) {
+			j = compile(node->getChild(i), locus-1);		// may reallocate m_children
+			m_children[start+i] = j;
+		}
+	}
+	m_subtree_end[k] = m_data.size();
+	return k;
+}
+
 HaploPattern *BackwardPatternTree::findLongestMatchPattern(int end, const HaploPattern *hp, int len) const
 {
 	if (end <= hp->start() || end > hp->end()) {
@@ -55,7 +95,7 @@ HaploPattern *BackwardPatternTree::findLongestMatchPattern(int end, const HaploP
 	else {
 		int max_len = end - hp->start();
 		if (len <= 0 || len > max_len) len = max_len;
-		return findLongestMatchPattern(&m_trees[end], hp, end-1, max_len-1, len);
+		return findMatchPattern(m_roots[end], hp, end-1, max_len-1, len, false);
 	}
 }
 
@@ -67,7 +107,7 @@ HaploPattern *BackwardPatternTree::findLongestMatchPattern(int end, const Allele
 	else {
 		int max_len = end - as_start;
 		if (len <= 0 || len > max_len) len = max_len;
-		return findLongestMatchPattern(&m_trees[end], as, end-1, max_len-1, len);
+		return findMatchPattern(m_roots[end], as, end-1, max_len-1, len, false);
 	}
 }
 
@@ -79,7 +119,7 @@ HaploPattern *BackwardPatternTree::findLikelyMatchPattern(int end, const HaploPa
 	else {
 		int max_len = end - hp->start();
 		if (len <= 0 || len > max_len) len = max_len;
-		return findLikelyMatchPattern(&m_trees[end], hp, end-1, max_len-1, len);
+		return findMatchPattern(m_roots[end], hp, end-1, max_len-1, len, true);
 	}
 }
 
@@ -91,82 +131,87 @@ HaploPattern *BackwardPatternTree::findLikelyMatchPattern(int end, const AlleleS
 	else {
 		int max_len = end - as_start;
 		if (len <= 0 || len > max_len) len = max_len;
-		return findLikelyMatchPattern(&m_trees[end], as, end-1, max_len-1, len);
+		return findMatchPattern(m_roots[end], as, end-1, max_len-1, len, true);
 	}
 }
 
-HaploPattern *BackwardPatternTree::findLongestMatchPattern(const PatternNode *node, const AlleleSequence *as, int lg, int ll, int len) const
+// all patterns ending at end whose last len alleles match as (which
+// starts at locus as_start), i.e. the subtrees below the matching nodes
+void BackwardPatternTree::findSuffixPatterns(int end, const AlleleSequence *as, int as_start, int len, vector<HaploPattern*> &patterns) const
 {
-	int i, n;
-	HaploPattern *result, *temp;
-	result = node->data();
-	if ((*as)[ll].isMissing()) {						// allele is missing
-		n = m_genos.allele_num(lg);
-		for (i=0; i<n; i++) {
-			if (node->getChild(i)) {					// previous locus is matching
-				if (len > 1) {
-					temp = findLongestMatchPattern(node->getChild(i), as, lg-1, ll-1, len-1);
-				}
-				else {
-					temp = node->getChild(i)->data();
-				}
-				if (result == 0 || (temp && temp->length() > result->length())) {
-					result = temp;
-				}
+	vector<pair<int, int> > branches;
+	int i, k, node, depth, ll;
+	patterns.clear();
+	if (len < 0 || end - len < as_start) return;
+	ll = end - 1 - as_start;
+	branches.push_back(make_pair(m_roots[end], 0));
+	while (!branches.empty()) {
+		node = branches.back().first;
+		depth = branches.back().second;
+		branches.pop_back();
+		if (depth == len) {
+			for (k=node; k<m_subtree_end[node]; ++k) {
+				if (m_data[k]) patterns.push_back(m_data[k]);
 			}
 		}
-	}
-	else {
-		i = m_genos.getAlleleIndex(lg, (*as)[ll]);
-		if (node->getChild(i)) {								// previous locus is matching
-			if (len > 1) {
-				temp = findLongestMatchPattern(node->getChild(i), as, lg-1, ll-1, len-1);
+		else if (m_child_start[node] >= 0) {
+			const Allele &a = (*as)[ll-depth];
+			if (a.isMissing()) {
+				for (i=m_genos.allele_num(end-1-depth)-1; i>=0; --i) {
+					k = child(node, i);
+					if (k >= 0) branches.push_back(make_pair(k, depth+1));
+				}
 			}
 			else {
-				temp = node->getChild(i)->data();
-			}
-			if (result == 0 || (temp && temp->length() > result->length())) {
-				result = temp;
+				i = m_genos.getAlleleIndex(end-1-depth, a);
+				k = i >= 0 ? child(node, i) : -1;
+				if (k >= 0) branches.push_back(make_pair(k, depth+1));
 			}
 		}
 	}
-	return result;
 }
 
-HaploPattern *BackwardPatternTree::findLikelyMatchPattern(const PatternNode *node, const AlleleSequence *as, int lg, int ll, int len) const
+// Visit the nodes matching as backward from node in preorder, children
+// in allele order, up to depth len.  Longest match keeps the first of the
+// longest patterns, likely match the last of the most likely ones, which
+// is what the former recursive search returned.
+HaploPattern *BackwardPatternTree::findMatchPattern(int node, const AlleleSequence *as, int lg, int ll, int len, bool likely) const
 {
-	int i, n;
-	HaploPattern *result, *temp;
-	result = node->data();
-	if ((*as)[ll].isMissing()) {						// allele is missing
-		n = m_genos.allele_num(lg);
-		for (i=0; i<n; i++) {
-			if (node->getChild(i)) {					// previous locus is matching
-				if (len > 1) {
-					temp = findLikelyMatchPattern(node->getChild(i), as, lg-1, ll-1, len-1);
-				}
-				else {
-					temp = node->getChild(i)->data();
-				}
-				if (result == 0 || (temp && temp->transition_prob() >= result->transition_prob())) {
-					result = temp;
-				}
-			}
+	vector<pair<int, int> > branches;					// only needed at missing alleles
+	HaploPattern *result = 0;
+	HaploPattern *hp;
+	int i, k, next, depth = 0;
+	for (;;) {
+		hp = m_data[node];
+		if (hp && (result == 0 || (likely ? hp->transition_prob() >= result->transition_prob() : hp->length() > result->length()))) {
+			result = hp;
 		}
-	}
-	else {
-		i = m_genos.getAlleleIndex(lg, (*as)[ll]);
-		if (node->getChild(i)) {						// previous locus is matching
-			if (len > 1) {
-				temp = findLikelyMatchPattern(node->getChild(i), as, lg-1, ll-1, len-1);
+		next = -1;
+		if (depth < len && m_child_start[node] >= 0) {
+			const Allele &a = (*as)[ll-depth];
+			if (a.isMissing()) {						// allele is missing
+				for (i=m_genos.allele_num(lg-depth)-1; i>=0; --i) {
+					k = child(node, i);
+					if (k >= 0) branches.push_back(make_pair(k, depth+1));
+				}
 			}
 			else {
-				temp = node->getChild(i)->data();
-			}
-			if (result == 0 || (temp && temp->transition_prob() >= result->transition_prob())) {
-				result = temp;
+				i = m_genos.getAlleleIndex(lg-depth, a);
+				if (i >= 0) next = child(node, i);
 			}
 		}
+		if (next >= 0) {
+			node = next;
+			++depth;
+		}
+		else if (!branches.empty()) {
+			node = branches.back().first;
+			depth = branches.back().second;
+			branches.pop_back();
+		}
+		else {
+			break;
+		}
 	}
 	return result;
 }
@@ -16,14 +16,29 @@ class GenoData;
 typedef TreeNode<HaploPattern*> PatternNode;
 
 
+// Patterns are added to a tree of nodes per end locus, walking backward
+// from the end.  compile() then flattens the trees into contiguous arrays
+// and frees the nodes; only the compiled tree can be searched.  Node k
+// holds pattern m_data[k], and if it has children, child i (allele index
+// i of the preceding locus) is m_children[m_child_start[k]+i] (-1 if none).
+// Nodes are in preorder, so the subtree of node k is [k, m_subtree_end[k]).
+
 class BackwardPatternTree {
 	const GenoData &m_genos;
 	vector<PatternNode> m_trees;
+	vector<int> m_roots;
+	vector<HaploPattern*> m_data;
+	vector<int> m_child_start;
+	vector<int> m_children;
+	vector<int> m_subtree_end;
 
 public:
 	explicit BackwardPatternTree(const GenoData &genos);
 
 	void addPattern(HaploPattern *hp) {	addPattern(&m_trees[hp->end()], hp, hp->length()); }
+	void compile();
+
+	int node_num() const { return m_data.size(); }
 
 	HaploPattern *findLongestMatchPattern(int end, const HaploPattern *hp, int len = 0) const;
 	HaploPattern *findLongestMatchPattern(int end, const AlleleSequence *as, int as_start = 0, int len = 0) const;
@@ -32,15 +47,23 @@ public:
 
 	HaploPattern *getSingleAllelePattern(int end, int index) const;
 
+	void findSuffixPatterns(int end, const AlleleSequence *as, int as_start, int len, vector<HaploPattern*> &patterns) const;
+
 protected:
 	void addPattern(PatternNode *node, HaploPattern *hp, int len);
-	HaploPattern *findLongestMatchPattern(const PatternNode *node, const AlleleSequence *as, int lg, int ll, int len) const;
-	HaploPattern *findLikelyMatchPattern(const PatternNode *node, const AlleleSequence *as, int lg, int ll, int len) const;
+	int compile(const PatternNode *node, int locus);
+	int child(int node, int i) const;
+	HaploPattern *findMatchPattern(int node, const AlleleSequence *as, int lg, int ll, int len, bool likely) const;
 };
 
+inline int BackwardPatternTree::child(int node, int i) const
+{
+	return m_child_start[node] < 0 ? -1 : m_children[m_child_start[node]+i];
+}
+
 inline HaploPattern *BackwardPatternTree::getSingleAllelePattern(int end, int index) const
 {
-	return m_trees[end].getChild(index)->data();
+	return m_data[child(m_roots[end], index)];
 }
 
 
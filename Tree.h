@@ -4,15 +4,13 @@
 
 
 #include <vector>
-#include <boost/pool/pool.hpp>
+#include <boost/pool/singleton_pool.hpp>
 
 #include "Utils.h"
 
 
 template <class T>
 class TreeNode : public NoThrowNewDelete {
-	static boost::pool<> m_pool;
-
 	TreeNode *m_parent;
 	vector<TreeNode*> m_children;
 	T m_data;
@@ -33,8 +31,8 @@ public:
 	using NoThrowNewDelete::operator new;
 	using NoThrowNewDelete::operator delete;
 
-	static void *operator new(std::size_t) { return m_pool.malloc(); }
-	static void operator delete(void *pMemory) { m_pool.free(pMemory); }
+	static void *operator new(std::size_t) { return boost::singleton_pool<TreeNode, sizeof(TreeNode)>::malloc(); }
+	static void operator delete(void *pMemory) { boost::singleton_pool<TreeNode, sizeof(TreeNode)>::free(pMemory); }
 };
 
 